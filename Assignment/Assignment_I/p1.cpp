@@ -3,12 +3,29 @@
 // 電子信箱：hctsai@linux
 // 日期：2025/09/09
 // 請注意這份檔案僅是做為程式設計的邏輯參考，可能不完全符合老師的胃口（可能不會拿到滿分）
-—
+// —
 
 #include <cstdio>
 #include <cstdlib>
 #include <cstdint>
 #include <cstring>
+#include <cstddef>
+#include <ctime>
+#include <climits>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>	// --threads 用；編譯時記得加 -pthread（g++ -O2 -pthread p1.cpp -o p1）
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 批次轉換的 SIMD 版本只在 x86 + GCC/Clang 底下編進來，其他平台一律走純量版本。
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define P1_X86_SIMD 1
+#else
+#define P1_X86_SIMD 0
+#endif
 
 // 按照講義命名為小寫 "date"，並且遵循老師說的不可以用 std::chrono 來偷吃步
 struct date
@@ -29,26 +46,15 @@ static const char *WEEK_SUN_TO_SAT[7] = {
 };
 
 // 閏年判斷用：400/100/4 規則
-static inline int is_leap(const int y)
+static constexpr int is_leap(const int y)
 {
 	if (y % 400 == 0) return 1;
 	if (y % 100 == 0) return 0;
 	return (y % 4 == 0);
 }
 
-// 日期的有效性檢查，像門禁（沒有4月31號）無法通過就過不了就不給進 main
-static int valid_date(const date &dt)
-{
-	if (dt.m < 1 || dt.m > 12) return 0;
-	static const int md[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
-	int lim = md[dt.m - 1];
-	if (dt.m == 2 && is_leap(dt.y)) lim = 29;
-	if (dt.d < 1 || dt.d > lim) return 0;
-	return 1;
-}
-
 // 上網調研的方法 "Gregorian ↔ JDN（Fliegel–Van Flandern）"，可將公曆日期換成連續整數（JDN），加減就變成小學算術。時間複雜度 O(1)，跨世紀也穩。
-static int64_t to_jdn(const int y0, const int m0, const int d0)
+static constexpr int64_t to_jdn(const int y0, const int m0, const int d0)
 {
 	int a = (14 - m0) / 12;
 	int y = y0 + 4800 - a;
@@ -71,14 +77,146 @@ static void from_jdn(const int64_t j, int &y, int &m, int &d)
 	y = (int)(100 * b + d1 - 4800 + (m1 / 10));
 }
 
-// date ⇄ 連號（JDN）
+// ============================================================
+// 熱門年份查表：1900..2100 的每年元旦 JDN 與每月累積天數在編譯期算好，
+// 範圍內的轉換只剩查表與加法，範圍外照舊走 Fliegel–Van Flandern。
+// 編譯時加 -DP1_YEAR_TABLE=0 可以整段關掉。
+// ============================================================
+
+#ifndef P1_YEAR_TABLE
+#define P1_YEAR_TABLE 1
+#endif
+
+#define TABLE_Y0 1900
+#define TABLE_Y1 2100
+#define TABLE_YEARS (TABLE_Y1 - TABLE_Y0 + 1)
+
+// 平年／閏年每個月 1 號之前累積的天數；[12] 是全年天數
+static constexpr int CUM_DAYS[2][13] = {
+	{ 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+	{ 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+};
+
+struct cal_table
+{
+	int64_t year_start[TABLE_YEARS + 1];	// 每年元旦的 JDN；最後一格是 2101 年元旦，當成上界
+	unsigned char leap[TABLE_YEARS];
+	unsigned char jan1_wd[TABLE_YEARS];	// 元旦是星期幾，Sunday = 0
+	unsigned char cum_mod7[2][12];		// CUM_DAYS % 7
+	unsigned char mod7[43];			// 0..42 的 % 7；星期幾的三項加起來不會超過 6 + 6 + 30
+};
+
+static constexpr cal_table make_cal_table()
+{
+	cal_table t = {};
+
+	int64_t j = to_jdn(TABLE_Y0, 1, 1);
+	for (int i = 0; i < TABLE_YEARS; i++)
+	{
+		int lp = is_leap(TABLE_Y0 + i);
+		t.year_start[i] = j;
+		t.leap[i] = (unsigned char)lp;
+		t.jan1_wd[i] = (unsigned char)((j + 1) % 7);
+		j += 365 + lp;
+	}
+	t.year_start[TABLE_YEARS] = j;
+
+	for (int lp = 0; lp < 2; lp++)
+		for (int m = 0; m < 12; m++)
+			t.cum_mod7[lp][m] = (unsigned char)(CUM_DAYS[lp][m] % 7);
+	for (int i = 0; i < 43; i++)
+		t.mod7[i] = (unsigned char)(i % 7);
+	return t;
+}
+
+static constexpr cal_table CAL = make_cal_table();
+
+static_assert(CAL.year_start[TABLE_YEARS] == to_jdn(TABLE_Y1 + 1, 1, 1), "查表的年份累積跟 to_jdn 對不上");
+
+// 以下四個函式都假設年份已在表內（cal_year 回傳值 < TABLE_YEARS），且不做任何除法
+static inline unsigned cal_year(const int y)
+{
+	return (unsigned)y - TABLE_Y0;
+}
+
+static inline int64_t cal_to_serial(const unsigned yi, const int m, const int d)
+{
+	return CAL.year_start[yi] + CUM_DAYS[CAL.leap[yi]][m - 1] + d - 1;
+}
+
+static inline int cal_month_days(const unsigned yi, const int m)
+{
+	const int *cum = CUM_DAYS[CAL.leap[yi]];
+	return cum[m] - cum[m - 1];
+}
+
+static inline int cal_weekday(const unsigned yi, const int m, const int d)
+{
+	return CAL.mod7[CAL.jan1_wd[yi] + CAL.cum_mod7[CAL.leap[yi]][m - 1] + d - 1];
+}
+
+static inline int cal_has_serial(const int64_t j)
+{
+	return j >= CAL.year_start[0] && j < CAL.year_start[TABLE_YEARS];
+}
+
+static inline date cal_from_serial(const int64_t j)
+{
+	// 先用乘法估年份（2871 / 2^20 ≈ 1 / 365.24），誤差最多一年，再用元旦表往前後修正
+	uint32_t off = (uint32_t)(j - CAL.year_start[0]);
+	unsigned yi = (off * 2871u) >> 20;
+	if (yi > TABLE_YEARS - 1) yi = TABLE_YEARS - 1;
+	while (CAL.year_start[yi + 1] <= j) yi++;
+	while (CAL.year_start[yi] > j) yi--;
+
+	// 每個月至少 28 天，doy / 32 一定不會超過真正的月份，往後最多修兩步
+	int doy = (int)(j - CAL.year_start[yi]);
+	const int *cum = CUM_DAYS[CAL.leap[yi]];
+	int mi = doy >> 5;
+	while (cum[mi + 1] <= doy) mi++;
+
+	date out;
+	out.y = TABLE_Y0 + (int)yi;
+	out.m = mi + 1;
+	out.d = doy - cum[mi] + 1;
+	return out;
+}
+
+// 日期的有效性檢查，像門禁（沒有4月31號）無法通過就過不了就不給進 main
+static int valid_date_rule(const date &dt)
+{
+	if (dt.m < 1 || dt.m > 12) return 0;
+	static const int md[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+	int lim = md[dt.m - 1];
+	if (dt.m == 2 && is_leap(dt.y)) lim = 29;
+	if (dt.d < 1 || dt.d > lim) return 0;
+	return 1;
+}
+
+static int valid_date(const date &dt)
+{
+#if P1_YEAR_TABLE
+	unsigned yi = cal_year(dt.y);
+	if (yi < TABLE_YEARS && (unsigned)(dt.m - 1) < 12) return dt.d >= 1 && dt.d <= cal_month_days(yi, dt.m);
+#endif
+	return valid_date_rule(dt);
+}
+
+// date ⇄ 連號（JDN）；to_jdn 對 d 是線性的，所以表內查法連不合法的日也算得一樣
 static int64_t DateToSerial(const date &dt)
 {
+#if P1_YEAR_TABLE
+	unsigned yi = cal_year(dt.y);
+	if (yi < TABLE_YEARS && (unsigned)(dt.m - 1) < 12) return cal_to_serial(yi, dt.m, dt.d);
+#endif
 	return to_jdn(dt.y, dt.m, dt.d);
 }
 
 static date SerialToDate(const int64_t j)
 {
+#if P1_YEAR_TABLE
+	if (cal_has_serial(j)) return cal_from_serial(j);
+#endif
 	date out;
 	from_jdn(j, out.y, out.m, out.d);
 	return out;
@@ -91,13 +229,21 @@ static const char* MonthName(const int m)
 }
 
 // DayOfWeek(date)：回傳 Sunday..Saturday，這裡把 Sunday 調整成 0，對齊講義輸出。
-static const char* DayOfWeek(const date &dt)
+static int DayOfWeekIndex(const date &dt)
 {
+#if P1_YEAR_TABLE
+	unsigned yi = cal_year(dt.y);
+	if (yi < TABLE_YEARS && (unsigned)(dt.m - 1) < 12 && (unsigned)(dt.d - 1) < 31) return cal_weekday(yi, dt.m, dt.d);
+#endif
 	int64_t j = DateToSerial(dt);
 	// JDN 的模 7：常見對應是 Monday=0..Sunday=6，這裡加一 來 shift 讓 Sunday 變成等於 0
 	int idx = (int)((j % 7 + 7) % 7);
-	int idx2 = (idx + 1) % 7; // Sunday=0, Monday=1, ..., Saturday=6
-	return WEEK_SUN_TO_SAT[idx2];
+	return (idx + 1) % 7; // Sunday=0, Monday=1, ..., Saturday=6
+}
+
+static const char* DayOfWeek(const date &dt)
+{
+	return WEEK_SUN_TO_SAT[DayOfWeekIndex(dt)];
 }
 
 // DateSub(d1,d2)：回傳「從 d1 到 d2」的有號天數
@@ -120,6 +266,419 @@ static date DateAdd(const date &d, const int n)
 	return SerialToDate(base + (int64_t)n);
 }
 
+// ============================================================
+// 批次日期運算：structure-of-arrays（y[]、m[]、d[] 各放一條），一次轉一整批
+// ============================================================
+
+// 一批日期拆成三條 int 陣列，SIMD 才能一次載入四個年、四個月、四個日。
+struct date_soa
+{
+	int *y;
+	int *m;
+	int *d;
+};
+
+// 向量版的整數除法全部改用 double 做：被除數 < 2^53 時，「浮點除法再往 0 截斷」跟 C 的整數除法結果一模一樣。
+// int 範圍的年份換成 JDN 最大也才 2^40 左右，離 2^53 還很遠，所以跟純量版逐位元相同。
+enum { SIMD_SCALAR = 0, SIMD_SSE41 = 1, SIMD_AVX2 = 2 };
+
+static const char *SIMD_NAMES[3] = { "scalar", "sse4.1", "avx2" };
+
+// -1 代表「還沒偵測」；benchmark 會暫時改寫它來強制走某一條路徑。
+static int g_simd_level = -1;
+
+static int simd_level(void)
+{
+	if (g_simd_level >= 0) return g_simd_level;
+	g_simd_level = SIMD_SCALAR;
+#if P1_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) g_simd_level = SIMD_AVX2;
+	else if (__builtin_cpu_supports("sse4.1")) g_simd_level = SIMD_SSE41;
+#endif
+	return g_simd_level;
+}
+
+static void to_jdn_batch_scalar(const int *y, const int *m, const int *d, int64_t *j, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		j[i] = to_jdn(y[i], m[i], d[i]);
+}
+
+static void from_jdn_batch_scalar(const int64_t *j, int *y, int *m, int *d, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		from_jdn(j[i], y[i], m[i], d[i]);
+}
+
+#if P1_X86_SIMD
+// double ⇄ int64：加上 1.5·2^52 之後，double 的尾數欄位剛好就是那個整數（|x| < 2^51 時成立）。
+#define P1_MAGIC_D 6755399441055744.0
+#define P1_MAGIC_I 0x4338000000000000LL
+
+__attribute__((target("avx2")))
+static void to_jdn_batch_avx2(const int *y, const int *m, const int *d, int64_t *j, const size_t n)
+{
+	const int tz = _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC;
+	const __m256d magic_d = _mm256_set1_pd(P1_MAGIC_D);
+	const __m256i magic_i = _mm256_set1_epi64x(P1_MAGIC_I);
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d vy = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(y + i)));
+		__m256d vm = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(m + i)));
+		__m256d vd = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(d + i)));
+
+		__m256d a = _mm256_round_pd(_mm256_div_pd(_mm256_sub_pd(_mm256_set1_pd(14.0), vm), _mm256_set1_pd(12.0)), tz);
+		__m256d yy = _mm256_sub_pd(_mm256_add_pd(vy, _mm256_set1_pd(4800.0)), a);
+		__m256d mm = _mm256_sub_pd(_mm256_add_pd(vm, _mm256_mul_pd(_mm256_set1_pd(12.0), a)), _mm256_set1_pd(3.0));
+
+		__m256d r = _mm256_add_pd(vd, _mm256_round_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(153.0), mm), _mm256_set1_pd(2.0)), _mm256_set1_pd(5.0)), tz));
+		r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_set1_pd(365.0), yy));
+		r = _mm256_add_pd(r, _mm256_round_pd(_mm256_div_pd(yy, _mm256_set1_pd(4.0)), tz));
+		r = _mm256_sub_pd(r, _mm256_round_pd(_mm256_div_pd(yy, _mm256_set1_pd(100.0)), tz));
+		r = _mm256_add_pd(r, _mm256_round_pd(_mm256_div_pd(yy, _mm256_set1_pd(400.0)), tz));
+		r = _mm256_sub_pd(r, _mm256_set1_pd(32045.0));
+
+		__m256i out = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(r, magic_d)), magic_i);
+		_mm256_storeu_si256((__m256i *)(j + i), out);
+	}
+	to_jdn_batch_scalar(y + i, m + i, d + i, j + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void from_jdn_batch_avx2(const int64_t *j, int *y, int *m, int *d, const size_t n)
+{
+	const int tz = _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC;
+	const __m256d magic_d = _mm256_set1_pd(P1_MAGIC_D);
+	const __m256i magic_i = _mm256_set1_epi64x(P1_MAGIC_I);
+	const __m256d c4 = _mm256_set1_pd(4.0);
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256i vj = _mm256_loadu_si256((const __m256i *)(j + i));
+		__m256d a = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(vj, magic_i)), magic_d);
+		a = _mm256_add_pd(a, _mm256_set1_pd(32044.0));
+
+		__m256d b = _mm256_round_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(c4, a), _mm256_set1_pd(3.0)), _mm256_set1_pd(146097.0)), tz);
+		__m256d c = _mm256_sub_pd(a, _mm256_round_pd(_mm256_div_pd(_mm256_mul_pd(_mm256_set1_pd(146097.0), b), c4), tz));
+		__m256d d1 = _mm256_round_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(c4, c), _mm256_set1_pd(3.0)), _mm256_set1_pd(1461.0)), tz);
+		__m256d e = _mm256_sub_pd(c, _mm256_round_pd(_mm256_div_pd(_mm256_mul_pd(_mm256_set1_pd(1461.0), d1), c4), tz));
+		__m256d m1 = _mm256_round_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(5.0), e), _mm256_set1_pd(2.0)), _mm256_set1_pd(153.0)), tz);
+		__m256d q = _mm256_round_pd(_mm256_div_pd(m1, _mm256_set1_pd(10.0)), tz);
+
+		__m256d vd = _mm256_add_pd(_mm256_sub_pd(e, _mm256_round_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(153.0), m1), _mm256_set1_pd(2.0)), _mm256_set1_pd(5.0)), tz)), _mm256_set1_pd(1.0));
+		__m256d vm = _mm256_sub_pd(_mm256_add_pd(m1, _mm256_set1_pd(3.0)), _mm256_mul_pd(_mm256_set1_pd(12.0), q));
+		__m256d vy = _mm256_add_pd(_mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(100.0), b), d1), _mm256_set1_pd(4800.0)), q);
+
+		_mm_storeu_si128((__m128i *)(y + i), _mm256_cvttpd_epi32(vy));
+		_mm_storeu_si128((__m128i *)(m + i), _mm256_cvttpd_epi32(vm));
+		_mm_storeu_si128((__m128i *)(d + i), _mm256_cvttpd_epi32(vd));
+	}
+	from_jdn_batch_scalar(j + i, y + i, m + i, d + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static void to_jdn_batch_sse41(const int *y, const int *m, const int *d, int64_t *j, const size_t n)
+{
+	const int tz = _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC;
+	const __m128d magic_d = _mm_set1_pd(P1_MAGIC_D);
+	const __m128i magic_i = _mm_set1_epi64x(P1_MAGIC_I);
+	size_t i = 0;
+
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d vy = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)(y + i)));
+		__m128d vm = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)(m + i)));
+		__m128d vd = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)(d + i)));
+
+		__m128d a = _mm_round_pd(_mm_div_pd(_mm_sub_pd(_mm_set1_pd(14.0), vm), _mm_set1_pd(12.0)), tz);
+		__m128d yy = _mm_sub_pd(_mm_add_pd(vy, _mm_set1_pd(4800.0)), a);
+		__m128d mm = _mm_sub_pd(_mm_add_pd(vm, _mm_mul_pd(_mm_set1_pd(12.0), a)), _mm_set1_pd(3.0));
+
+		__m128d r = _mm_add_pd(vd, _mm_round_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(153.0), mm), _mm_set1_pd(2.0)), _mm_set1_pd(5.0)), tz));
+		r = _mm_add_pd(r, _mm_mul_pd(_mm_set1_pd(365.0), yy));
+		r = _mm_add_pd(r, _mm_round_pd(_mm_div_pd(yy, _mm_set1_pd(4.0)), tz));
+		r = _mm_sub_pd(r, _mm_round_pd(_mm_div_pd(yy, _mm_set1_pd(100.0)), tz));
+		r = _mm_add_pd(r, _mm_round_pd(_mm_div_pd(yy, _mm_set1_pd(400.0)), tz));
+		r = _mm_sub_pd(r, _mm_set1_pd(32045.0));
+
+		__m128i out = _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(r, magic_d)), magic_i);
+		_mm_storeu_si128((__m128i *)(j + i), out);
+	}
+	to_jdn_batch_scalar(y + i, m + i, d + i, j + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static void from_jdn_batch_sse41(const int64_t *j, int *y, int *m, int *d, const size_t n)
+{
+	const int tz = _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC;
+	const __m128d magic_d = _mm_set1_pd(P1_MAGIC_D);
+	const __m128i magic_i = _mm_set1_epi64x(P1_MAGIC_I);
+	const __m128d c4 = _mm_set1_pd(4.0);
+	size_t i = 0;
+
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128i vj = _mm_loadu_si128((const __m128i *)(j + i));
+		__m128d a = _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(vj, magic_i)), magic_d);
+		a = _mm_add_pd(a, _mm_set1_pd(32044.0));
+
+		__m128d b = _mm_round_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(c4, a), _mm_set1_pd(3.0)), _mm_set1_pd(146097.0)), tz);
+		__m128d c = _mm_sub_pd(a, _mm_round_pd(_mm_div_pd(_mm_mul_pd(_mm_set1_pd(146097.0), b), c4), tz));
+		__m128d d1 = _mm_round_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(c4, c), _mm_set1_pd(3.0)), _mm_set1_pd(1461.0)), tz);
+		__m128d e = _mm_sub_pd(c, _mm_round_pd(_mm_div_pd(_mm_mul_pd(_mm_set1_pd(1461.0), d1), c4), tz));
+		__m128d m1 = _mm_round_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(5.0), e), _mm_set1_pd(2.0)), _mm_set1_pd(153.0)), tz);
+		__m128d q = _mm_round_pd(_mm_div_pd(m1, _mm_set1_pd(10.0)), tz);
+
+		__m128d vd = _mm_add_pd(_mm_sub_pd(e, _mm_round_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(153.0), m1), _mm_set1_pd(2.0)), _mm_set1_pd(5.0)), tz)), _mm_set1_pd(1.0));
+		__m128d vm = _mm_sub_pd(_mm_add_pd(m1, _mm_set1_pd(3.0)), _mm_mul_pd(_mm_set1_pd(12.0), q));
+		__m128d vy = _mm_add_pd(_mm_sub_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(100.0), b), d1), _mm_set1_pd(4800.0)), q);
+
+		_mm_storel_epi64((__m128i *)(y + i), _mm_cvttpd_epi32(vy));
+		_mm_storel_epi64((__m128i *)(m + i), _mm_cvttpd_epi32(vm));
+		_mm_storel_epi64((__m128i *)(d + i), _mm_cvttpd_epi32(vd));
+	}
+	from_jdn_batch_scalar(j + i, y + i, m + i, d + i, n - i);
+}
+#endif
+
+// DateToSerial 的批次版：out[i] = DateToSerial(in[i])，執行時挑 CPU 支援的最寬指令集。
+static void DateToSerialBatch(const date_soa &in, int64_t *out, const size_t n)
+{
+	switch (simd_level())
+	{
+#if P1_X86_SIMD
+	case SIMD_AVX2:  to_jdn_batch_avx2(in.y, in.m, in.d, out, n); return;
+	case SIMD_SSE41: to_jdn_batch_sse41(in.y, in.m, in.d, out, n); return;
+#endif
+	default:         to_jdn_batch_scalar(in.y, in.m, in.d, out, n); return;
+	}
+}
+
+static void SerialToDateBatch(const int64_t *j, date_soa &out, const size_t n)
+{
+	switch (simd_level())
+	{
+#if P1_X86_SIMD
+	case SIMD_AVX2:  from_jdn_batch_avx2(j, out.y, out.m, out.d, n); return;
+	case SIMD_SSE41: from_jdn_batch_sse41(j, out.y, out.m, out.d, n); return;
+#endif
+	default:         from_jdn_batch_scalar(j, out.y, out.m, out.d, n); return;
+	}
+}
+
+// 批次版的中間序號放在堆疊上的小緩衝區，一段一段做，免得呼叫端還要幫忙準備暫存陣列。
+#define BATCH_CHUNK 512
+
+// DateAddBatch：out[i] = DateAdd(in[i], x[i])；in 與 out 可以是同一組陣列。
+static void DateAddBatch(const date_soa &in, const int *x, date_soa &out, const size_t n)
+{
+	int64_t j[BATCH_CHUNK];
+
+	for (size_t base = 0; base < n; base += BATCH_CHUNK)
+	{
+		size_t len = n - base < BATCH_CHUNK ? n - base : BATCH_CHUNK;
+		date_soa src = { in.y + base, in.m + base, in.d + base };
+		date_soa dst = { out.y + base, out.m + base, out.d + base };
+
+		DateToSerialBatch(src, j, len);
+		for (size_t i = 0; i < len; i++)
+			j[i] += x[base + i];
+		SerialToDateBatch(j, dst, len);
+	}
+}
+
+// DateSubBatch：out[i] = DateSub(a[i], b[i])，夾擠規則跟純量版一樣。
+static void DateSubBatch(const date_soa &a, const date_soa &b, int *out, const size_t n)
+{
+	int64_t ja[BATCH_CHUNK], jb[BATCH_CHUNK];
+
+	for (size_t base = 0; base < n; base += BATCH_CHUNK)
+	{
+		size_t len = n - base < BATCH_CHUNK ? n - base : BATCH_CHUNK;
+		date_soa sa = { a.y + base, a.m + base, a.d + base };
+		date_soa sb = { b.y + base, b.m + base, b.d + base };
+
+		DateToSerialBatch(sa, ja, len);
+		DateToSerialBatch(sb, jb, len);
+		for (size_t i = 0; i < len; i++)
+		{
+			int64_t diff = jb[i] - ja[i];
+			if (diff < -(int64_t)0x7fffffff) diff = -(int64_t)0x7fffffff;
+			if (diff >  (int64_t)0x7fffffff) diff =  (int64_t)0x7fffffff;
+			out[base + i] = (int)diff;
+		}
+	}
+}
+
+// DayOfWeekBatch：out[i] = DayOfWeek(in[i])，回傳的是同一組星期名字串指標。
+static void DayOfWeekBatch(const date_soa &in, const char **out, const size_t n)
+{
+	int64_t j[BATCH_CHUNK];
+
+	for (size_t base = 0; base < n; base += BATCH_CHUNK)
+	{
+		size_t len = n - base < BATCH_CHUNK ? n - base : BATCH_CHUNK;
+		date_soa src = { in.y + base, in.m + base, in.d + base };
+
+		DateToSerialBatch(src, j, len);
+		for (size_t i = 0; i < len; i++)
+		{
+			int idx = (int)((j[i] % 7 + 7) % 7);
+			out[base + i] = WEEK_SUN_TO_SAT[(idx + 1) % 7];
+		}
+	}
+}
+
+// ============================================================
+// 日期區間與逐步走訪：日／週／月一步一步往後推，不必每一步都繞一趟 JDN
+// ============================================================
+
+enum { STEP_DAY = 0, STEP_WEEK, STEP_MONTH };
+
+// 當月天數；表內年份直接查表
+static int DaysInMonth(const int y, const int m)
+{
+#if P1_YEAR_TABLE
+	unsigned yi = cal_year(y);
+	if (yi < TABLE_YEARS) return cal_month_days(yi, m);
+#endif
+	static const int md[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+	return md[m - 1] + (m == 2 && is_leap(y));
+}
+
+// 日期先後：比年、再比月、再比日
+static int date_cmp(const date &a, const date &b)
+{
+	if (a.y != b.y) return a.y < b.y ? -1 : 1;
+	if (a.m != b.m) return a.m < b.m ? -1 : 1;
+	if (a.d != b.d) return a.d < b.d ? -1 : 1;
+	return 0;
+}
+
+// 走訪器：cur 一定是合法日期，起點也必須合法
+struct date_iter
+{
+	date cur;
+	int step;	// STEP_DAY / STEP_WEEK / STEP_MONTH
+	int n;		// 每一步走幾個單位（>= 1）
+	int dim;	// cur 那個月的天數
+	int day;	// 月步進想要的「幾號」；小月先夾到月底，之後遇到大月再回來（1/31 → 2/28 → 3/31）
+};
+
+static void date_iter_init(date_iter &it, const date &start, const int step, const int n)
+{
+	it.cur = start;
+	it.step = step;
+	it.n = n < 1 ? 1 : n;
+	it.dim = DaysInMonth(start.y, start.m);
+	it.day = start.d;
+}
+
+// 往後走一步：日／週步進平常只是 d += k，跨月時才查一次天數
+static void date_iter_next(date_iter &it)
+{
+	date &c = it.cur;
+
+	if (it.step == STEP_MONTH)
+	{
+		c.m += it.n;
+		if (c.m > 12)
+		{
+			c.y += (c.m - 1) / 12;
+			c.m = (c.m - 1) % 12 + 1;
+		}
+		it.dim = DaysInMonth(c.y, c.m);
+		c.d = it.day < it.dim ? it.day : it.dim;
+		return;
+	}
+
+	c.d += it.step == STEP_WEEK ? 7 * it.n : it.n;
+	while (c.d > it.dim)
+	{
+		c.d -= it.dim;
+		if (++c.m > 12)
+		{
+			c.m = 1;
+			c.y++;
+		}
+		it.dim = DaysInMonth(c.y, c.m);
+	}
+}
+
+// from..to（含兩端）每隔 n 個單位取一個日期，最多寫 max 個到 out；
+// 回傳值是區間裡總共有幾個（可能比 max 大，跟 snprintf 一樣，可以先問大小再配置）
+static size_t DateRange(const date &from, const date &to, const int step, const int n, date *out, const size_t max)
+{
+	date_iter it;
+	size_t count = 0;
+
+	date_iter_init(it, from, step, n);
+	while (date_cmp(it.cur, to) <= 0)
+	{
+		if (count < max) out[count] = it.cur;
+		count++;
+		date_iter_next(it);
+	}
+	return count;
+}
+
+// from..to 之間每隔 every 週的某個星期幾（Sunday = 0）；第一個是 from 當天或之後最近的那一天
+static size_t DateRangeWeekday(const date &from, const date &to, const int weekday, const int every, date *out, const size_t max)
+{
+	int shift = ((weekday - DayOfWeekIndex(from)) % 7 + 7) % 7;
+	return DateRange(DateAdd(from, shift), to, STEP_WEEK, every, out, max);
+}
+
+// 從 start（必須合法）開始連續 n 天：整個月剩下的日子一口氣填完，跨月才查天數
+static void DateFill(const date &start, date *out, const size_t n)
+{
+	date c = start;
+	int dim = DaysInMonth(c.y, c.m);
+	size_t i = 0;
+
+	while (i < n)
+	{
+		for (; c.d <= dim && i < n; c.d++)
+			out[i++] = c;
+		c.d = 1;
+		if (++c.m > 12)
+		{
+			c.m = 1;
+			c.y++;
+		}
+		dim = DaysInMonth(c.y, c.m);
+	}
+}
+
+// DateFill 的 SoA 版，直接餵給上面的批次 API
+static void DateFillBatch(const date &start, date_soa &out, const size_t n)
+{
+	date c = start;
+	int dim = DaysInMonth(c.y, c.m);
+	size_t i = 0;
+
+	while (i < n)
+	{
+		for (; c.d <= dim && i < n; c.d++, i++)
+		{
+			out.y[i] = c.y;
+			out.m[i] = c.m;
+			out.d[i] = c.d;
+		}
+		c.d = 1;
+		if (++c.m > 12)
+		{
+			c.m = 1;
+			c.y++;
+		}
+		dim = DaysInMonth(c.y, c.m);
+	}
+}
+
 // 輸出：MonthName dd, yyyy；規格要求的字面格式，逗號與空白都符合要求。
 static void print_month_date_year(const date &dt)
 {
@@ -170,56 +729,2486 @@ static int parse_line_type1(const char *s, date &a)
 	return 0;
 }
 
-int main()
+// 三個 parse 依序試下去的結果：一行屬於哪一種查詢
+enum { Q_NONE = 0, Q_RANGE, Q_ADD, Q_WEEKDAY };
+
+static int classify_line_sscanf(const char *s, date &d1, date &d2, int &k)
 {
-	// I/O 走「多筆直到 EOF」：遵照官教授網站提供的範例程式碼的格式。
-	char buf[256];
-	date d1, d2;
+	if (parse_line_type2(s, d1, d2)) return Q_RANGE;
+	if (parse_line_type3(s, d1, k)) return Q_ADD;
+	if (parse_line_type1(s, d1)) return Q_WEEKDAY;
+	return Q_NONE;
+}
 
-	while (std::fgets(buf, sizeof(buf), stdin))
+// 一行查詢的回答：門禁、計算、印出三步都在這裡，逐行版與串流版共用，輸出才會一字不差。
+static void answer_query(const int kind, const date &d1, const date &d2, const int k)
+{
+	// 關卡 1：區間（from..to）
+	if (kind == Q_RANGE)
 	{
-		// 關卡 1：區間（from..to）
-		if (parse_line_type2(buf, d1, d2))
-		{
-			// 門禁：語法無效就不通過（避免印出怪日期）
-			if (!valid_date(d1) || !valid_date(d2)) continue;
+		// 門禁：語法無效就不通過（避免印出怪日期）
+		if (!valid_date(d1) || !valid_date(d2)) return;
 
-			int x = DateSub(d1, d2); // 有號天數：from d1 to d2
-			std::printf("%d days from ", x);
-			print_month_date_year(d1);
-			std::printf(" to ");
-			print_month_date_year(d2);
-			std::printf(".\n");
-			continue;
-		}
+		int x = DateSub(d1, d2); // 有號天數：from d1 to d2
+		std::printf("%d days from ", x);
+		print_month_date_year(d1);
+		std::printf(" to ");
+		print_month_date_year(d2);
+		std::printf(".\n");
+		return;
+	}
 
-		// 關卡 2：加法（after）
-		int k = 0;
-		if (parse_line_type3(buf, d1, k))
-		{
-			if (!valid_date(d1)) continue;
+	// 關卡 2：加法（after）
+	if (kind == Q_ADD)
+	{
+		if (!valid_date(d1)) return;
 
-			date d3 = DateAdd(d1, k);
-			std::printf("%d days after ", k);
-			print_month_date_year(d1);
-			std::printf(" is ");
-			print_month_date_year(d3);
-			std::printf(".\n");
-			continue;
-		}
+		date d3 = DateAdd(d1, k);
+		std::printf("%d days after ", k);
+		print_month_date_year(d1);
+		std::printf(" is ");
+		print_month_date_year(d3);
+		std::printf(".\n");
+		return;
+	}
 
-		// 關卡 3：單日（is Weekday）
-		if (parse_line_type1(buf, d1))
-		{
-			if (!valid_date(d1)) continue;
+	// 關卡 3：單日（is Weekday）
+	if (kind == Q_WEEKDAY)
+	{
+		if (!valid_date(d1)) return;
 
-			const char *w = DayOfWeek(d1);
-			print_month_date_year(d1);
-			std::printf(" is %s.\n", w);
-			continue;
-		}
+		const char *w = DayOfWeek(d1);
+		print_month_date_year(d1);
+		std::printf(" is %s.\n", w);
+		return;
+	}
+
+	// 其他：看不懂就裝死（沉默是金）。規格沒要報錯，我們就安靜忽略。
+}
+
+// ============================================================
+// 串流輸入：mmap 或大區塊 read()，加上手寫的整數掃描器取代 sscanf
+// ============================================================
+
+// 跟 C locale 的 isspace 一樣：空白、\t \n \v \f \r
+static inline int is_space(const int c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline int is_digit(const int c)
+{
+	return (unsigned)(c - '0') <= 9;
+}
+
+static inline const char *skip_space(const char *p, const char *end)
+{
+	while (p < end && is_space(*p)) p++;
+	return p;
+}
+
+// 模仿 sscanf 的 %d：跳過空白、可選正負號、至少一位數字。
+// 超大數字跟 glibc 一樣先夾到 long 的範圍、再截成 int，所以連亂打的輸入都跟原本的輸出相同。
+static const char *scan_int(const char *p, const char *end, int &out)
+{
+	p = skip_space(p, end);
+	int neg = 0;
+	if (p < end && (*p == '+' || *p == '-'))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	if (p >= end || !is_digit(*p)) return NULL;
+
+	uint64_t v = 0;
+	int over = 0;
+	do
+	{
+		unsigned dg = (unsigned)(*p - '0');
+		if (v > (UINT64_MAX - dg) / 10) over = 1;
+		else v = v * 10 + dg;
+		p++;
+	} while (p < end && is_digit(*p));
+
+	long r;
+	if (neg) r = (over || v > (uint64_t)LONG_MAX + 1) ? LONG_MIN : (long)(0 - v);
+	else r = (over || v > (uint64_t)LONG_MAX) ? LONG_MAX : (long)v;
+	out = (int)r;
+	return p;
+}
 
-		// 其他：看不懂就裝死（沉默是金）。規格沒要報錯，我們就安靜忽略。
+// "%d/%d/%d"：斜線前後不能有空白，但 %d 自己會吃掉數字前的空白，跟 sscanf 一樣。
+static const char *scan_ymd(const char *p, const char *end, date &a)
+{
+	if (!(p = scan_int(p, end, a.y)) || p == end || *p++ != '/') return NULL;
+	if (!(p = scan_int(p, end, a.m)) || p == end || *p++ != '/') return NULL;
+	return scan_int(p, end, a.d);
+}
+
+// 一趟掃完就分類：三種格式的開頭都是 yyyy/mm/dd，所以先讀這段，再看後面接 '-'、'+' 還是什麼都沒有。
+// 判斷順序跟 type2 → type3 → type1 完全一樣：'-' 後面讀不到完整日期、'+' 後面讀不到數字，都退回單日。
+static int classify_line_fast(const char *s, const char *end, date &d1, date &d2, int &k)
+{
+	const char *p = scan_ymd(s, end, d1);
+	if (!p) return Q_NONE;
+
+	p = skip_space(p, end);
+	if (p < end && *p == '-')
+	{
+		if (scan_ymd(p + 1, end, d2)) return Q_RANGE;
+	}
+	else if (p < end && *p == '+')
+	{
+		if (scan_int(p + 1, end, k)) return Q_ADD;
+	}
+	return Q_WEEKDAY;
+}
+
+// fgets(buf, 256) 一次最多拿 255 個位元組，超長的行會被切成好幾段、每段各自解析；串流版照樣切。
+#define FGETS_PIECE 255
+#define STREAM_BLOCK ((size_t)1 << 20)
+
+typedef void (*line_handler)(const char *s, const char *end, void *ctx);
+
+// 把 [p, end) 切成跟 fgets 一模一樣的片段交給 fn；at_eof 為 0 時，最後不完整的一行留著，回傳它的開頭。
+static const char *split_lines(const char *p, const char *end, const int at_eof, line_handler fn, void *ctx)
+{
+	while (p < end)
+	{
+		const char *nl = (const char *) std::memchr(p, '\n', (size_t)(end - p));
+		if (!nl && !at_eof)
+		{
+			// 還沒看到換行：滿 255 個位元組的部分 fgets 一定會先吐出來，剩下的等下一塊
+			while (end - p >= FGETS_PIECE)
+			{
+				fn(p, p + FGETS_PIECE, ctx);
+				p += FGETS_PIECE;
+			}
+			break;
+		}
+
+		const char *stop = nl ? nl + 1 : end;
+		while (stop - p > FGETS_PIECE)
+		{
+			fn(p, p + FGETS_PIECE, ctx);
+			p += FGETS_PIECE;
+		}
+		fn(p, stop, ctx);
+		p = stop;
+	}
+	return p;
+}
+
+// 整個檔案交給 fn：一般檔案直接 mmap（零複製），pipe 之類不能 mmap 的就每次 read() 1 MiB。
+static int stream_fd(const int fd, const int allow_mmap, line_handler fn, void *ctx)
+{
+	struct stat st;
+	if (allow_mmap && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		off_t pos = lseek(fd, 0, SEEK_CUR);
+		if (pos == 0)
+		{
+			size_t size = (size_t)st.st_size;
+			void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED)
+			{
+				madvise(map, size, MADV_SEQUENTIAL);
+				split_lines((const char *)map, (const char *)map + size, 1, fn, ctx);
+				munmap(map, size);
+				return 0;
+			}
+		}
+	}
+
+	char *buf = (char *) std::malloc(STREAM_BLOCK + FGETS_PIECE);
+	if (!buf) return -1;
+
+	size_t have = 0;
+	for (;;)
+	{
+		ssize_t r = read(fd, buf + have, STREAM_BLOCK);
+		if (r < 0 && errno == EINTR) continue;
+		if (r <= 0) break;
+
+		have += (size_t)r;
+		const char *rest = split_lines(buf, buf + have, 0, fn, ctx);
+		have = (size_t)(buf + have - rest);
+		std::memmove(buf, rest, have);
+	}
+	split_lines(buf, buf + have, 1, fn, ctx);
+	std::free(buf);
+	return 0;
+}
+
+static void answer_line_fast(const char *s, const char *end, void *)
+{
+	date d1, d2;
+	int k = 0;
+	int kind = classify_line_fast(s, end, d1, d2, k);
+	answer_query(kind, d1, d2, k);
+}
+
+// ============================================================
+// 緩衝輸出：整批寫進大緩衝區、滿了才一次 fwrite，取代每行 4~6 次 printf
+// ============================================================
+
+#define OUT_BLOCK ((size_t)1 << 20)
+// 一行回答最長也才九十幾個位元組（兩個 -2147483648 年加上 September），每行先保留 128 就不用逐欄檢查
+#define OUT_LINE_MAX 128
+
+// 名字長度先算好，輸出時直接 memcpy，不必每次 strlen
+static const unsigned char MONTH_LEN[12] = { 7, 8, 5, 5, 3, 4, 4, 6, 9, 7, 8, 8 };
+static const unsigned char WEEK_LEN[7] = { 6, 6, 7, 9, 8, 6, 8 };
+
+// 00..99 的兩位數字表，整數轉字串一次處理兩位
+static const char DIGITS2[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+struct out_buf
+{
+	char *base;
+	char *p;
+	char *end;
+	FILE *f;	// 滿了就 fwrite 到這裡；NULL 代表不輸出、空間不夠就長大
+};
+
+static void out_init(out_buf &o, FILE *f, const size_t cap)
+{
+	o.base = (char *) std::malloc(cap);
+	if (!o.base)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		std::exit(1);
+	}
+	o.p = o.base;
+	o.end = o.base + cap;
+	o.f = f;
+}
+
+static void out_flush(out_buf &o)
+{
+	if (o.f && o.p > o.base)
+		std::fwrite(o.base, 1, (size_t)(o.p - o.base), o.f);
+	o.p = o.base;
+}
+
+static void out_free(out_buf &o)
+{
+	out_flush(o);
+	std::free(o.base);
+	o.base = o.p = o.end = NULL;
+}
+
+// 保證後面還有 need 個位元組可以直接寫
+static inline void out_reserve(out_buf &o, const size_t need)
+{
+	if ((size_t)(o.end - o.p) >= need) return;
+	if (o.f)
+	{
+		out_flush(o);
+		if ((size_t)(o.end - o.p) >= need) return;
+	}
+
+	size_t used = (size_t)(o.p - o.base);
+	size_t cap = (size_t)(o.end - o.base) * 2;
+	while (cap - used < need) cap *= 2;
+	char *nb = (char *) std::realloc(o.base, cap);
+	if (!nb)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		std::exit(1);
+	}
+	o.base = nb;
+	o.p = nb + used;
+	o.end = nb + cap;
+}
+
+static inline char *put_mem(char *p, const char *s, const size_t n)
+{
+	std::memcpy(p, s, n);
+	return p + n;
+}
+
+// 等同 printf("%d")：先用無號數處理絕對值，INT_MIN 也不會溢位
+static inline char *put_int(char *p, const int v)
+{
+	char tmp[12];
+	char *t = tmp + sizeof(tmp);
+	uint32_t u = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+
+	while (u >= 100)
+	{
+		uint32_t r = u % 100;
+		u /= 100;
+		t -= 2;
+		std::memcpy(t, DIGITS2 + 2 * r, 2);
+	}
+	if (u >= 10)
+	{
+		t -= 2;
+		std::memcpy(t, DIGITS2 + 2 * u, 2);
+	}
+	else
+		*--t = (char)('0' + u);
+	if (v < 0) *--t = '-';
+	return put_mem(p, t, (size_t)(tmp + sizeof(tmp) - t));
+}
+
+// print_month_date_year 的緩衝版："MonthName dd, yyyy"
+// JDN < -32044（約西元前 4800 年）時 from_jdn 的截斷除法會算出 1..12 以外的月份，printf 版會讀到 MONTHS 外面；
+// 這裡不跟著越界，月份名字就留空。
+static inline char *put_month_date_year(char *p, const date &dt)
+{
+	if ((unsigned)(dt.m - 1) < 12)
+		p = put_mem(p, MonthName(dt.m), MONTH_LEN[dt.m - 1]);
+	*p++ = ' ';
+	p = put_int(p, dt.d);
+	*p++ = ',';
+	*p++ = ' ';
+	return put_int(p, dt.y);
+}
+
+// answer_query 的緩衝版：門禁與計算完全相同，只是字元直接寫進 out_buf
+static void format_query(out_buf &o, const int kind, const date &d1, const date &d2, const int k)
+{
+	char *p;
+
+	if (kind == Q_RANGE)
+	{
+		if (!valid_date(d1) || !valid_date(d2)) return;
+
+		out_reserve(o, OUT_LINE_MAX);
+		p = put_int(o.p, DateSub(d1, d2));
+		p = put_mem(p, " days from ", 11);
+		p = put_month_date_year(p, d1);
+		p = put_mem(p, " to ", 4);
+		p = put_month_date_year(p, d2);
+		o.p = put_mem(p, ".\n", 2);
+		return;
+	}
+
+	if (kind == Q_ADD)
+	{
+		if (!valid_date(d1)) return;
+
+		out_reserve(o, OUT_LINE_MAX);
+		p = put_int(o.p, k);
+		p = put_mem(p, " days after ", 12);
+		p = put_month_date_year(p, d1);
+		p = put_mem(p, " is ", 4);
+		p = put_month_date_year(p, DateAdd(d1, k));
+		o.p = put_mem(p, ".\n", 2);
+		return;
+	}
+
+	if (kind == Q_WEEKDAY)
+	{
+		if (!valid_date(d1)) return;
+
+		int w = DayOfWeekIndex(d1);
+		out_reserve(o, OUT_LINE_MAX);
+		p = put_month_date_year(o.p, d1);
+		p = put_mem(p, " is ", 4);
+		p = put_mem(p, WEEK_SUN_TO_SAT[w], WEEK_LEN[w]);
+		o.p = put_mem(p, ".\n", 2);
+	}
+}
+
+static void format_line_fast(const char *s, const char *end, void *ctx)
+{
+	date d1, d2;
+	int k = 0;
+	int kind = classify_line_fast(s, end, d1, d2, k);
+	format_query(*(out_buf *)ctx, kind, d1, d2, k);
+}
+
+// ============================================================
+// 查詢結果快取：同一行原始輸入（整段位元組）直接對應到格式化好的輸出，命中時連解析帶格式化都省掉。
+// 容量固定，滿了用 CLOCK（二次機會）淘汰：命中只設參考位元，不必像 LRU 每次搬動串列。
+// ============================================================
+
+// 一格剛好兩條 cache line：正常的查詢行與回答都放得下，放不下的就略過快取
+#define QC_KEY_MAX 32
+#define QC_OUT_MAX 80
+#define QC_CAP_MAX (1 << 24)	// --cache= 的上限：一格 128 bytes，2 GiB 已經很夠了
+
+struct qc_slot
+{
+	uint64_t hash;
+	int next;		// 同一個 bucket 的下一格，-1 代表結尾
+	unsigned char key_len;
+	unsigned char out_len;	// 不合法的行輸出是空的，一樣記起來
+	unsigned char ref;	// CLOCK 的參考位元
+	unsigned char pad;
+	char key[QC_KEY_MAX];
+	char out[QC_OUT_MAX];
+};
+
+static_assert(sizeof(qc_slot) == 128, "qc_slot 應該剛好兩條 cache line");
+
+struct query_cache
+{
+	qc_slot *slot;
+	int *bucket;
+	unsigned mask;
+	int cap;
+	int size;
+	int hand;		// CLOCK 的指針
+	uint64_t hits, misses, evictions, bypass;	// bypass：行或回答太長，沒有放進快取
+};
+
+// FNV-1a：行很短，逐位元組就夠快了
+static inline uint64_t hash_bytes(const char *s, const size_t n)
+{
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < n; i++)
+	{
+		h ^= (unsigned char)s[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static int qc_init(query_cache &c, const int cap)
+{
+	std::memset(&c, 0, sizeof(c));
+	if (cap <= 0 || cap > QC_CAP_MAX) return -1;	// 太大的話下面的 bucket 數會溢位
+
+	size_t nb = 1;
+	while (nb < (size_t)cap * 2) nb <<= 1;
+
+	c.cap = cap;
+	c.mask = (unsigned)(nb - 1);
+	c.slot = (qc_slot *) aligned_alloc(64, sizeof(qc_slot) * (size_t)cap);
+	c.bucket = (int *) std::malloc(sizeof(int) * nb);
+	if (!c.slot || !c.bucket) return -1;
+	for (size_t i = 0; i < nb; i++)
+		c.bucket[i] = -1;
+	return 0;
+}
+
+static void qc_free(query_cache &c)
+{
+	std::free(c.bucket);
+	std::free(c.slot);
+	c.slot = NULL;
+	c.bucket = NULL;
+}
+
+static const qc_slot *qc_lookup(query_cache &c, const uint64_t h, const char *s, const size_t n)
+{
+	for (int i = c.bucket[h & c.mask]; i >= 0; i = c.slot[i].next)
+	{
+		qc_slot &e = c.slot[i];
+		if (e.hash == h && e.key_len == n && std::memcmp(e.key, s, n) == 0)
+		{
+			e.ref = 1;
+			return &e;
+		}
+	}
+	return NULL;
+}
+
+static void qc_insert(query_cache &c, const uint64_t h, const char *s, const size_t n, const char *out, const size_t out_len)
+{
+	int i;
+	if (c.size < c.cap)
+		i = c.size++;
+	else
+	{
+		// CLOCK：參考位元是 1 的先清掉、給第二次機會，遇到 0 的就淘汰它
+		while (c.slot[c.hand].ref)
+		{
+			c.slot[c.hand].ref = 0;
+			c.hand = c.hand + 1 == c.cap ? 0 : c.hand + 1;
+		}
+		i = c.hand;
+		c.hand = c.hand + 1 == c.cap ? 0 : c.hand + 1;
+
+		int *link = &c.bucket[c.slot[i].hash & c.mask];
+		while (*link != i) link = &c.slot[*link].next;
+		*link = c.slot[i].next;
+		c.evictions++;
+	}
+
+	qc_slot &e = c.slot[i];
+	e.hash = h;
+	e.key_len = (unsigned char)n;
+	e.out_len = (unsigned char)out_len;
+	e.ref = 0;
+	std::memcpy(e.key, s, n);
+	std::memcpy(e.out, out, out_len);
+	e.next = c.bucket[h & c.mask];
+	c.bucket[h & c.mask] = i;
+}
+
+static void qc_report(const query_cache &c, FILE *f)
+{
+	uint64_t total = c.hits + c.misses;
+	std::fprintf(f, "cache: capacity %d, %llu hits, %llu misses (hit rate %.2f%%), %llu evictions, %llu bypassed\n",
+	             c.cap, (unsigned long long)c.hits, (unsigned long long)c.misses,
+	             total ? 100.0 * (double)c.hits / (double)total : 0.0,
+	             (unsigned long long)c.evictions, (unsigned long long)c.bypass);
+}
+
+struct cached_sink
+{
+	out_buf *o;
+	query_cache *c;
+};
+
+static void format_line_cached(const char *s, const char *end, void *ctx)
+{
+	cached_sink *cs = (cached_sink *)ctx;
+	out_buf &o = *cs->o;
+	query_cache &c = *cs->c;
+	size_t n = (size_t)(end - s);
+
+	if (n > QC_KEY_MAX)
+	{
+		c.bypass++;
+		format_line_fast(s, end, &o);
+		return;
+	}
+
+	uint64_t h = hash_bytes(s, n);
+	const qc_slot *e = qc_lookup(c, h, s, n);
+	if (e)
+	{
+		c.hits++;
+		out_reserve(o, OUT_LINE_MAX);
+		o.p = put_mem(o.p, e->out, e->out_len);
+		return;
+	}
+
+	// 先把一整行的空間保留好，format_query 裡就不會 flush，before 指標才不會失效
+	c.misses++;
+	out_reserve(o, OUT_LINE_MAX);
+	char *before = o.p;
+	format_line_fast(s, end, &o);
+	if ((size_t)(o.p - before) <= QC_OUT_MAX)
+		qc_insert(c, h, s, n, before, (size_t)(o.p - before));
+	else
+		c.bypass++;
+}
+
+// ============================================================
+// 多執行緒管線：輸入依換行切成區段，各執行緒把自己的區段解析、計算、格式化進獨立緩衝區，
+// 主執行緒再照原本順序寫出，所以輸出跟單執行緒版完全一樣。
+// ============================================================
+
+#define PAR_CHUNK_BYTES ((size_t)1 << 20)	// 每個區段大約 1 MiB 的輸入
+#define PAR_CHUNKS_PER_THREAD 4			// 區段切細一點，執行緒之間比較不會互等
+
+struct par_chunk
+{
+	const char *begin;
+	const char *end;
+	out_buf out;
+	int done;
+};
+
+struct par_pipeline
+{
+	int nthreads;
+	pthread_t *tid;
+	par_chunk *chunk;
+	int cap;	// 一輪最多幾個區段
+	int count;	// 這一輪實際切出幾個
+	int next;	// 下一個還沒有人領的區段
+	int quit;
+	pthread_mutex_t mu;
+	pthread_cond_t work;
+	pthread_cond_t done;
+};
+
+static void *par_worker(void *arg)
+{
+	par_pipeline *pl = (par_pipeline *)arg;
+
+	pthread_mutex_lock(&pl->mu);
+	for (;;)
+	{
+		while (!pl->quit && pl->next >= pl->count)
+			pthread_cond_wait(&pl->work, &pl->mu);
+		if (pl->quit) break;
+		par_chunk *c = &pl->chunk[pl->next++];
+		pthread_mutex_unlock(&pl->mu);
+
+		// 區段一定以換行（或檔案結尾）收尾，所以當成 at_eof 處理就跟 fgets 切法一致
+		c->out.p = c->out.base;
+		split_lines(c->begin, c->end, 1, format_line_fast, &c->out);
+
+		pthread_mutex_lock(&pl->mu);
+		c->done = 1;
+		pthread_cond_broadcast(&pl->done);
+	}
+	pthread_mutex_unlock(&pl->mu);
+	return NULL;
+}
+
+static int par_init(par_pipeline &pl, const int nthreads)
+{
+	pl.nthreads = nthreads;
+	pl.cap = nthreads * PAR_CHUNKS_PER_THREAD;
+	pl.count = pl.next = pl.quit = 0;
+	pl.tid = (pthread_t *) std::malloc(sizeof(pthread_t) * nthreads);
+	pl.chunk = (par_chunk *) std::calloc(pl.cap, sizeof(par_chunk));
+	if (!pl.tid || !pl.chunk) return -1;
+
+	// 每個區段的輸出緩衝區整個程式只配一次，之後每一輪重複使用
+	for (int i = 0; i < pl.cap; i++)
+		out_init(pl.chunk[i].out, NULL, PAR_CHUNK_BYTES * 2);
+
+	pthread_mutex_init(&pl.mu, NULL);
+	pthread_cond_init(&pl.work, NULL);
+	pthread_cond_init(&pl.done, NULL);
+	for (int i = 0; i < nthreads; i++)
+		if (pthread_create(&pl.tid[i], NULL, par_worker, &pl) != 0) return -1;
+	return 0;
+}
+
+static void par_destroy(par_pipeline &pl)
+{
+	pthread_mutex_lock(&pl.mu);
+	pl.quit = 1;
+	pthread_cond_broadcast(&pl.work);
+	pthread_mutex_unlock(&pl.mu);
+	for (int i = 0; i < pl.nthreads; i++)
+		pthread_join(pl.tid[i], NULL);
+
+	for (int i = 0; i < pl.cap; i++)
+		out_free(pl.chunk[i].out);
+	pthread_cond_destroy(&pl.done);
+	pthread_cond_destroy(&pl.work);
+	pthread_mutex_destroy(&pl.mu);
+	std::free(pl.chunk);
+	std::free(pl.tid);
+}
+
+// 處理一段以換行（或檔案結尾）收尾的輸入：切成最多 cap 個區段丟給工作執行緒，照順序寫到 f
+static void par_round(par_pipeline &pl, const char *p, const char *end, FILE *f)
+{
+	if (p >= end) return;
+
+	size_t len = (size_t)(end - p);
+	size_t want = len / PAR_CHUNK_BYTES + 1;
+	if (want < (size_t)pl.nthreads) want = (size_t)pl.nthreads;
+	if (want > (size_t)pl.cap) want = (size_t)pl.cap;
+	size_t step = len / want + 1;
+
+	pthread_mutex_lock(&pl.mu);
+	int n = 0;
+	while (p < end)
+	{
+		const char *stop = end;
+		if ((size_t)(end - p) > step)
+		{
+			const char *nl = (const char *) std::memchr(p + step, '\n', (size_t)(end - p - step));
+			if (nl && n < pl.cap - 1) stop = nl + 1;
+		}
+		pl.chunk[n].begin = p;
+		pl.chunk[n].end = stop;
+		pl.chunk[n].done = 0;
+		n++;
+		p = stop;
+	}
+	pl.count = n;
+	pl.next = 0;
+	pthread_cond_broadcast(&pl.work);
+	pthread_mutex_unlock(&pl.mu);
+
+	// 寫出的同時後面的區段還在算
+	for (int i = 0; i < n; i++)
+	{
+		pthread_mutex_lock(&pl.mu);
+		while (!pl.chunk[i].done)
+			pthread_cond_wait(&pl.done, &pl.mu);
+		pthread_mutex_unlock(&pl.mu);
+
+		out_buf &o = pl.chunk[i].out;
+		std::fwrite(o.base, 1, (size_t)(o.p - o.base), f);
+	}
+}
+
+// 平行版的主迴圈：一般檔案整個 mmap 進來一輪一輪處理；pipe 則一次讀一整個視窗，把最後不完整的行留給下一輪
+static int run_parallel(const int fd, const int nthreads, FILE *f)
+{
+	par_pipeline pl;
+	if (par_init(pl, nthreads) < 0)
+	{
+		std::fprintf(stderr, "無法建立執行緒！\n");
+		return -1;
+	}
+	size_t window = (size_t)pl.cap * PAR_CHUNK_BYTES;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && lseek(fd, 0, SEEK_CUR) == 0)
+	{
+		size_t size = (size_t)st.st_size;
+		void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			madvise(map, size, MADV_SEQUENTIAL);
+			const char *p = (const char *)map, *end = p + size;
+			while (p < end)
+			{
+				const char *stop = end;
+				if ((size_t)(end - p) > window)
+				{
+					const char *nl = (const char *) std::memchr(p + window, '\n', (size_t)(end - p - window));
+					if (nl) stop = nl + 1;
+				}
+				par_round(pl, p, stop, f);
+				p = stop;
+			}
+			munmap(map, size);
+			par_destroy(pl);
+			return 0;
+		}
+	}
+
+	size_t cap = window;
+	char *buf = (char *) std::malloc(cap);
+	size_t have = 0;
+	int eof = 0;
+	while (buf)
+	{
+		while (!eof && have < cap)
+		{
+			ssize_t r = read(fd, buf + have, cap - have);
+			if (r < 0 && errno == EINTR) continue;
+			if (r <= 0) eof = 1;
+			else have += (size_t)r;
+		}
+
+		char *stop = buf + have;
+		if (!eof)
+		{
+			while (stop > buf && stop[-1] != '\n') stop--;
+			if (stop == buf)
+			{
+				// 整個視窗都沒有換行（超長的一行）：放大緩衝區再多讀一點
+				cap *= 2;
+				char *nb = (char *) std::realloc(buf, cap);
+				if (!nb) break;
+				buf = nb;
+				continue;
+			}
+		}
+
+		par_round(pl, buf, stop, f);
+		have = (size_t)(buf + have - stop);
+		std::memmove(buf, stop, have);
+		if (eof && have == 0) break;
+	}
+
+	int rc = buf ? 0 : -1;
+	std::free(buf);
+	par_destroy(pl);
+	return rc;
+}
+
+// 沒指定執行緒數時用線上的 CPU 數
+static int online_cpus(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+
+// ============================================================
+// 二進位欄式格式：每筆固定寬度、按欄位一塊一塊存，讀寫都不必解析或格式化文字
+// ============================================================
+// 檔頭 16 位元組：magic（查詢檔 "P1DQ"、答案檔 "P1DA"）、版本、日期編碼（BIN_PACKED／BIN_SERIAL），其餘保留填 0。
+// 之後是一塊塊資料：uint32 筆數 n（≤ BIN_BLOCK）、uint8 kind[n]（補 0 到 4 的倍數），再接 int32 欄位陣列：
+//   查詢塊：a[n] 第一個日期；b[n] 第二個日期（區間）或天數 x（加法），單日查詢的 b 填 0
+//   答案塊：只有 a[n]，區間 → 天數、加法 → 結果日期、單日 → 星期幾（Sunday=0）；kind 為 Q_NONE 表示這筆沒有答案
+// 整數一律用本機位元組順序（x86 是 little-endian），這個格式不打算跨平台搬。
+
+#define BIN_VERSION 1
+#define BIN_BLOCK 4096
+
+enum { BIN_PACKED = 0, BIN_SERIAL = 1 };
+
+static const char BIN_MAGIC_QUERY[4] = { 'P', '1', 'D', 'Q' };
+static const char BIN_MAGIC_ANSWER[4] = { 'P', '1', 'D', 'A' };
+
+struct bin_header
+{
+	char magic[4];
+	uint8_t version;
+	uint8_t layout;
+	uint8_t reserved[10];
+};
+static_assert(sizeof(bin_header) == 16, "bin_header 應該是 16 位元組");
+
+struct bin_block
+{
+	uint32_t n;
+	uint8_t kind[BIN_BLOCK];
+	int32_t a[BIN_BLOCK];
+	int32_t b[BIN_BLOCK];
+};
+
+// packed：年佔高 23 位（有號）、月 4 位、日 5 位
+#define PACK_Y_MIN (-(1 << 22))
+#define PACK_Y_MAX ((1 << 22) - 1)
+
+// from_jdn 只在 JDN >= -32044（西元前 4800 年 3 月 1 日）時算得對，serial 編碼就從這裡開始
+#define BIN_SERIAL_MIN (-32044)
+
+static inline int32_t pack_ymd(const date &dt)
+{
+	return (int32_t)(((uint32_t)dt.y << 9) | ((uint32_t)dt.m << 5) | (uint32_t)dt.d);
+}
+
+static inline date unpack_ymd(const int32_t v)
+{
+	date t;
+	t.y = v >> 9;	// 有號右移，GCC/Clang 都是算術位移
+	t.m = (v >> 5) & 15;
+	t.d = v & 31;
+	return t;
+}
+
+// 合法日期 → 欄位值；這種編碼裝不下就回 0
+static int bin_encode(const int layout, const date &dt, int32_t &v)
+{
+	if (layout == BIN_PACKED)
+	{
+		if (dt.y < PACK_Y_MIN || dt.y > PACK_Y_MAX) return 0;
+		v = pack_ymd(dt);
+		return 1;
+	}
+
+	int64_t j = DateToSerial(dt);
+	if (j < BIN_SERIAL_MIN || j > INT32_MAX) return 0;
+	date back = SerialToDate(j);
+	if (back.y != dt.y || back.m != dt.m || back.d != dt.d) return 0;
+	v = (int32_t)j;
+	return 1;
+}
+
+// 欄位值 → 連號；不合法（packed 的日期不存在、serial 超出範圍）回 0
+static inline int bin_serial(const int layout, const int32_t v, int64_t &j)
+{
+	if (layout == BIN_SERIAL)
+	{
+		j = v;
+		return v >= BIN_SERIAL_MIN;
+	}
+	date t = unpack_ymd(v);
+	if (!valid_date(t)) return 0;
+	j = DateToSerial(t);
+	return 1;
+}
+
+static inline int bin_decode(const int layout, const int32_t v, date &dt)
+{
+	if (layout == BIN_PACKED)
+	{
+		dt = unpack_ymd(v);
+		return valid_date(dt);
+	}
+	if (v < BIN_SERIAL_MIN) return 0;
+	dt = SerialToDate(v);
+	return 1;
+}
+
+static int bin_write_header(FILE *f, const char *magic, const int layout)
+{
+	bin_header h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, magic, 4);
+	h.version = BIN_VERSION;
+	h.layout = (uint8_t)layout;
+	return std::fwrite(&h, sizeof(h), 1, f) == 1;
+}
+
+static int bin_read_header(FILE *f, const char *magic, int &layout)
+{
+	bin_header h;
+	if (std::fread(&h, sizeof(h), 1, f) != 1 || std::memcmp(h.magic, magic, 4) != 0 || h.version != BIN_VERSION
+		|| (h.layout != BIN_PACKED && h.layout != BIN_SERIAL))
+	{
+		std::fprintf(stderr, "不是 %.4s 格式的二進位檔！\n", magic);
+		return 0;
+	}
+	layout = h.layout;
+	return 1;
+}
+
+// cols = 2 是查詢塊（a、b），1 是答案塊（只有 a）
+static int bin_write_block(FILE *f, const bin_block &blk, const int cols)
+{
+	static const uint8_t zero[4] = { 0, 0, 0, 0 };
+	size_t n = blk.n;
+	size_t pad = (4 - n % 4) % 4;
+	if (std::fwrite(&blk.n, sizeof(blk.n), 1, f) != 1) return 0;
+	if (std::fwrite(blk.kind, 1, n, f) != n || std::fwrite(zero, 1, pad, f) != pad) return 0;
+	if (std::fwrite(blk.a, sizeof(int32_t), n, f) != n) return 0;
+	if (cols == 2 && std::fwrite(blk.b, sizeof(int32_t), n, f) != n) return 0;
+	return 1;
+}
+
+// 回傳 1：讀到一塊；0：檔案結束；-1：格式錯誤或檔案被截斷
+static int bin_read_block(FILE *f, bin_block &blk, const int cols)
+{
+	uint8_t pad[4];
+	if (std::fread(&blk.n, sizeof(blk.n), 1, f) != 1) return 0;
+	size_t n = blk.n;
+	if (n > BIN_BLOCK) return -1;
+	if (std::fread(blk.kind, 1, n, f) != n || std::fread(pad, 1, (4 - n % 4) % 4, f) != (4 - n % 4) % 4) return -1;
+	if (std::fread(blk.a, sizeof(int32_t), n, f) != n) return -1;
+	if (cols == 2 && std::fread(blk.b, sizeof(int32_t), n, f) != n) return -1;
+	return 1;
+}
+
+static bin_block *bin_block_new(void)
+{
+	bin_block *b = (bin_block *) std::malloc(sizeof(bin_block));
+	if (!b)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		std::exit(1);
+	}
+	b->n = 0;
+	return b;
+}
+
+// 文字 → 二進位查詢：解析規則跟文字模式一樣；日期不合法的行在文字模式也不會有輸出，直接丟掉
+struct bin_writer
+{
+	FILE *f;
+	int layout;
+	bin_block *blk;
+	size_t skipped;	// 合法但這種編碼裝不下的查詢
+};
+
+static void bin_put_line(const char *s, const char *end, void *ctx)
+{
+	bin_writer &w = *(bin_writer *)ctx;
+	bin_block &b = *w.blk;
+	date d1, d2;
+	int k = 0;
+	int kind = classify_line_fast(s, end, d1, d2, k);
+	if (kind == Q_NONE) return;
+	if (!valid_date(d1) || (kind == Q_RANGE && !valid_date(d2))) return;
+
+	uint32_t i = b.n;
+	if (!bin_encode(w.layout, d1, b.a[i]) || (kind == Q_RANGE && !bin_encode(w.layout, d2, b.b[i])))
+	{
+		w.skipped++;
+		return;
+	}
+	if (kind == Q_ADD) b.b[i] = k;
+	else if (kind == Q_WEEKDAY) b.b[i] = 0;
+	b.kind[i] = (uint8_t)kind;
+	if (++b.n == BIN_BLOCK)
+	{
+		bin_write_block(w.f, b, 2);
+		b.n = 0;
+	}
+}
+
+static int text_to_bin(const int fd, FILE *f, const int layout, size_t &skipped)
+{
+	bin_writer w = { f, layout, bin_block_new(), 0 };
+	int rc = bin_write_header(f, BIN_MAGIC_QUERY, layout) ? stream_fd(fd, 1, bin_put_line, &w) : -1;
+	if (rc == 0 && w.blk->n > 0 && !bin_write_block(f, *w.blk, 2)) rc = -1;
+	std::fflush(f);
+	std::free(w.blk);
+	skipped = w.skipped;
+	return rc;
+}
+
+static inline char *put_ymd(char *p, const date &dt)
+{
+	p = put_int(p, dt.y);
+	*p++ = '/';
+	p = put_int(p, dt.m);
+	*p++ = '/';
+	return put_int(p, dt.d);
+}
+
+// 二進位 → 文字：查詢檔轉回 "yyyy/mm/dd - ..." 的輸入語法；
+// 答案檔一筆一行（天數、y/m/d、星期幾），沒有答案的那筆印空行，行號才對得回查詢。
+static int bin_to_text(FILE *in, FILE *out)
+{
+	bin_header h;
+	if (std::fread(&h, sizeof(h), 1, in) != 1)
+	{
+		std::fprintf(stderr, "讀不到二進位檔頭！\n");
+		return -1;
+	}
+	int answers = std::memcmp(h.magic, BIN_MAGIC_ANSWER, 4) == 0;
+	int layout = h.layout;
+	if ((!answers && std::memcmp(h.magic, BIN_MAGIC_QUERY, 4) != 0) || h.version != BIN_VERSION
+		|| (layout != BIN_PACKED && layout != BIN_SERIAL))
+	{
+		std::fprintf(stderr, "不是 p1 的二進位檔！\n");
+		return -1;
+	}
+
+	bin_block *b = bin_block_new();
+	out_buf o;
+	out_init(o, out, OUT_BLOCK);
+	int rc;
+	while ((rc = bin_read_block(in, *b, answers ? 1 : 2)) > 0)
+	{
+		for (uint32_t i = 0; i < b->n; i++)
+		{
+			int kind = b->kind[i];
+			date d1, d2;
+			out_reserve(o, OUT_LINE_MAX);
+			char *p = o.p;
+			if (answers)
+			{
+				if (kind == Q_RANGE) p = put_int(p, b->a[i]);
+				else if (kind == Q_ADD && bin_decode(layout, b->a[i], d1)) p = put_ymd(p, d1);
+				else if (kind == Q_WEEKDAY && (unsigned)b->a[i] < 7) p = put_mem(p, WEEK_SUN_TO_SAT[b->a[i]], WEEK_LEN[b->a[i]]);
+				*p++ = '\n';
+				o.p = p;
+				continue;
+			}
+
+			if (!bin_decode(layout, b->a[i], d1)) continue;
+			if (kind == Q_RANGE)
+			{
+				if (!bin_decode(layout, b->b[i], d2)) continue;
+				p = put_ymd(p, d1);
+				p = put_mem(p, " - ", 3);
+				p = put_ymd(p, d2);
+			}
+			else if (kind == Q_ADD)
+			{
+				p = put_ymd(p, d1);
+				p = put_mem(p, " + ", 3);
+				p = put_int(p, b->b[i]);
+			}
+			else if (kind == Q_WEEKDAY)
+				p = put_ymd(p, d1);
+			else
+				continue;
+			*p++ = '\n';
+			o.p = p;
+		}
+	}
+	out_free(o);
+	std::free(b);
+	if (rc < 0) std::fprintf(stderr, "二進位檔格式錯誤或被截斷！\n");
+	return rc;
+}
+
+// 一塊查詢 → 一塊答案。serial 編碼時完全不用換算日期：區間是相減、加法是相加、星期幾是模 7。
+static void bin_answer_block(const int layout, const bin_block &q, bin_block &r, size_t &lost)
+{
+	r.n = q.n;
+	for (uint32_t i = 0; i < q.n; i++)
+	{
+		int kind = q.kind[i];
+		int64_t a, b;
+		r.kind[i] = Q_NONE;
+		r.a[i] = 0;
+		if (!bin_serial(layout, q.a[i], a)) continue;
+
+		if (kind == Q_RANGE)
+		{
+			if (!bin_serial(layout, q.b[i], b)) continue;
+			int64_t diff = b - a;	// 跟 DateSub 一樣夾在 int 範圍內
+			if (diff < -(int64_t)0x7fffffff) diff = -(int64_t)0x7fffffff;
+			if (diff >  (int64_t)0x7fffffff) diff =  (int64_t)0x7fffffff;
+			r.a[i] = (int32_t)diff;
+		}
+		else if (kind == Q_ADD)
+		{
+			int64_t j = a + q.b[i];
+			if (layout == BIN_SERIAL)
+			{
+				if (j < BIN_SERIAL_MIN || j > INT32_MAX)
+				{
+					lost++;
+					continue;
+				}
+				r.a[i] = (int32_t)j;
+			}
+			else
+			{
+				date t = SerialToDate(j);
+				if (j < BIN_SERIAL_MIN || t.y < PACK_Y_MIN || t.y > PACK_Y_MAX)
+				{
+					lost++;
+					continue;
+				}
+				r.a[i] = pack_ymd(t);
+			}
+		}
+		else if (kind == Q_WEEKDAY)
+			r.a[i] = (int32_t)(((a % 7 + 7) % 7 + 1) % 7);
+		else
+			continue;
+		r.kind[i] = (uint8_t)kind;
+	}
+}
+
+// 一塊查詢 → 文字答案，內容跟文字模式逐位元組相同
+static void bin_format_block(out_buf &o, const int layout, const bin_block &q)
+{
+	for (uint32_t i = 0; i < q.n; i++)
+	{
+		int kind = q.kind[i];
+		date d1, d2 = { 0, 0, 0 };
+		if (!bin_decode(layout, q.a[i], d1)) continue;
+		if (kind == Q_RANGE && !bin_decode(layout, q.b[i], d2)) continue;
+		format_query(o, kind, d1, d2, q.b[i]);
+	}
+}
+
+// 讀二進位查詢檔；bin_out 為 0 時輸出作業規定的句子，否則寫同一種日期編碼的答案檔
+static int run_binary(FILE *in, FILE *out, const int bin_out)
+{
+	int layout;
+	if (!bin_read_header(in, BIN_MAGIC_QUERY, layout)) return -1;
+
+	bin_block *q = bin_block_new();
+	bin_block *r = bin_out ? bin_block_new() : NULL;
+	out_buf o;
+	size_t lost = 0;
+	int rc;
+
+	if (bin_out) bin_write_header(out, BIN_MAGIC_ANSWER, layout);
+	else out_init(o, out, OUT_BLOCK);
+
+	while ((rc = bin_read_block(in, *q, 2)) > 0)
+	{
+		if (bin_out)
+		{
+			bin_answer_block(layout, *q, *r, lost);
+			if (!bin_write_block(out, *r, 1)) rc = -1;
+		}
+		else
+			bin_format_block(o, layout, *q);
+		if (rc < 0) break;
+	}
+
+	if (bin_out) std::fflush(out);
+	else out_free(o);
+	if (rc < 0) std::fprintf(stderr, "二進位檔格式錯誤或被截斷！\n");
+	if (lost) std::fprintf(stderr, "有 %zu 筆加法的結果超出這種日期編碼的範圍，標成沒有答案\n", lost);
+	std::free(q);
+	std::free(r);
+	return rc;
+}
+
+// ============================================================
+// 工作日運算：週一到週五、再扣掉假日表；不逐日走，用前綴計數一步算出來
+// ============================================================
+// 記號：W(s) = 連號小於 s 的工作日個數（原點隨便，只拿來相減）
+//     = plain(s) − 連號小於 s 的假日數；plain(s) 是小於 s 的週一到週五個數，有公式可算。
+// 假日數在假日表涵蓋的年份內查 bitmap，加上每 64 天一格的前綴計數，O(1)；範圍外不是 0 就是全部。
+// 反過來找「第 T 個工作日」是在 rank[] 上二分搜尋，O(log H)。
+
+struct biz_cal
+{
+	int64_t *hol;		// 排序、去重、只留落在平日的假日連號（週末本來就不上班）
+	int64_t *rank;		// rank[i] = plain(hol[i]) − i，非遞減
+	size_t nh;
+	int64_t base;		// bitmap 的第一天：假日最早那年的 1/1
+	int64_t days;		// bitmap 涵蓋的天數，到假日最晚那年的 12/31
+	uint64_t *bits;		// 第 s − base 位是 1：那天放假
+	uint32_t *before;	// before[w]：第 w 格（64 天）之前的假日數
+};
+
+static inline int64_t floor_div(const int64_t a, const int64_t b)
+{
+	int64_t q = a / b;
+	return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// JDN 模 7 是 0 的那天是星期一
+static inline int64_t plain_before(const int64_t s)
+{
+	int64_t w = floor_div(s, 7);
+	int64_t r = s - 7 * w;
+	return 5 * w + (r < 5 ? r : 5);
+}
+
+// plain 的反函數：第 q 個平日的連號
+static inline int64_t plain_nth(const int64_t q)
+{
+	int64_t w = floor_div(q, 5);
+	return 7 * w + (q - 5 * w);
+}
+
+static inline int is_weekday_serial(const int64_t s)
+{
+	return s - 7 * floor_div(s, 7) < 5;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void biz_free(biz_cal &c)
+{
+	std::free(c.hol);
+	std::free(c.rank);
+	std::free(c.bits);
+	std::free(c.before);
+	std::memset(&c, 0, sizeof(c));
+}
+
+// serials 不必排序、可以重複；失敗回 -1
+static int biz_init(biz_cal &c, const int64_t *serials, const size_t n)
+{
+	std::memset(&c, 0, sizeof(c));
+	c.hol = (int64_t *) std::malloc(sizeof(int64_t) * (n ? n : 1));
+	if (!c.hol) return -1;
+
+	size_t m = 0;
+	for (size_t i = 0; i < n; i++)
+		if (is_weekday_serial(serials[i])) c.hol[m++] = serials[i];
+	std::qsort(c.hol, m, sizeof(int64_t), cmp_i64);
+	size_t u = 0;
+	for (size_t i = 0; i < m; i++)
+		if (u == 0 || c.hol[u - 1] != c.hol[i]) c.hol[u++] = c.hol[i];
+	c.nh = u;
+
+	c.rank = (int64_t *) std::malloc(sizeof(int64_t) * (u ? u : 1));
+	if (!c.rank)
+	{
+		biz_free(c);
+		return -1;
+	}
+	for (size_t i = 0; i < u; i++)
+		c.rank[i] = plain_before(c.hol[i]) - (int64_t)i;
+	if (u == 0) return 0;
+
+	// bitmap 以整年為單位
+	c.base = DateToSerial(date{SerialToDate(c.hol[0]).y, 1, 1});
+	c.days = DateToSerial(date{SerialToDate(c.hol[u - 1]).y + 1, 1, 1}) - c.base;
+	size_t words = (size_t)(c.days + 63) / 64;
+	c.bits = (uint64_t *) std::calloc(words, sizeof(uint64_t));
+	c.before = (uint32_t *) std::malloc(sizeof(uint32_t) * words);
+	if (!c.bits || !c.before)
+	{
+		biz_free(c);
+		return -1;
+	}
+	for (size_t i = 0; i < u; i++)
+	{
+		uint64_t off = (uint64_t)(c.hol[i] - c.base);
+		c.bits[off >> 6] |= (uint64_t)1 << (off & 63);
+	}
+	uint32_t acc = 0;
+	for (size_t w = 0; w < words; w++)
+	{
+		c.before[w] = acc;
+		acc += (uint32_t)__builtin_popcountll(c.bits[w]);
+	}
+	return 0;
+}
+
+// 連號小於 s 的假日數
+static inline int64_t biz_holidays_before(const biz_cal &c, const int64_t s)
+{
+	int64_t off = s - c.base;
+	if (off <= 0) return 0;
+	if (off >= c.days) return (int64_t)c.nh;
+	uint64_t w = (uint64_t)off >> 6, bit = (uint64_t)off & 63;
+	return c.before[w] + __builtin_popcountll(c.bits[w] & (((uint64_t)1 << bit) - 1));
+}
+
+static inline int64_t biz_count_before(const biz_cal &c, const int64_t s)
+{
+	return plain_before(s) - biz_holidays_before(c, s);
+}
+
+static inline int biz_is_workday(const biz_cal &c, const int64_t s)
+{
+	if (!is_weekday_serial(s)) return 0;
+	int64_t off = s - c.base;
+	return off < 0 || off >= c.days || !((c.bits[(uint64_t)off >> 6] >> (off & 63)) & 1);
+}
+
+// W(s) = t 的那個工作日 s：平日編號 q = t + #{ i : rank[i] <= t }
+static int64_t biz_nth(const biz_cal &c, const int64_t t)
+{
+	size_t lo = 0, hi = c.nh;
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (c.rank[mid] <= t) lo = mid + 1;
+		else hi = mid;
+	}
+	return plain_nth(t + (int64_t)lo);
+}
+
+// BizDaysBetween(d1,d2)：[d1, d2) 裡的工作日數，d2 在前面時回負值；語意跟 DateSub 的 b − a 一樣
+static int BizDaysBetween(const biz_cal &c, const date &d1, const date &d2)
+{
+	int64_t diff = biz_count_before(c, DateToSerial(d2)) - biz_count_before(c, DateToSerial(d1));
+	if (diff < -(int64_t)0x7fffffff) diff = -(int64_t)0x7fffffff;
+	if (diff >  (int64_t)0x7fffffff) diff =  (int64_t)0x7fffffff;
+	return (int)diff;
+}
+
+// BizDaysAdd(d,n)：d 之後第 n 個工作日（d 本身不算）；n < 0 往前找，n == 0 就是 d
+static date BizDaysAdd(const biz_cal &c, const date &d, const int n)
+{
+	int64_t s = DateToSerial(d);
+	if (n == 0) return d;
+	if (n > 0) return SerialToDate(biz_nth(c, biz_count_before(c, s + 1) + n - 1));
+	return SerialToDate(biz_nth(c, biz_count_before(c, s) + n));
+}
+
+// 假日檔：一行一個 yyyy/mm/dd，其他看不懂的行（註解、空行）略過
+struct serial_list
+{
+	int64_t *v;
+	size_t n, cap;
+};
+
+static void holiday_line(const char *s, const char *end, void *ctx)
+{
+	serial_list &l = *(serial_list *)ctx;
+	date d1, d2;
+	int k = 0;
+	if (classify_line_fast(s, end, d1, d2, k) != Q_WEEKDAY || !valid_date(d1)) return;
+	if (l.n == l.cap)
+	{
+		size_t cap = l.cap ? l.cap * 2 : 256;
+		int64_t *nv = (int64_t *) std::realloc(l.v, sizeof(int64_t) * cap);
+		if (!nv)
+		{
+			std::fprintf(stderr, "記憶體配置失敗！\n");
+			std::exit(1);
+		}
+		l.v = nv;
+		l.cap = cap;
+	}
+	l.v[l.n++] = DateToSerial(d1);
+}
+
+static int biz_load(biz_cal &c, const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		std::fprintf(stderr, "無法開啟假日檔 %s\n", path);
+		return -1;
+	}
+	serial_list l = { NULL, 0, 0 };
+	int rc = stream_fd(fd, 1, holiday_line, &l);
+	close(fd);
+	if (rc == 0) rc = biz_init(c, l.v, l.n);
+	std::free(l.v);
+	return rc;
+}
+
+// --holidays 模式的輸出：三種查詢換成工作日的版本
+static void format_biz_query(out_buf &o, const biz_cal &c, const int kind, const date &d1, const date &d2, const int k)
+{
+	char *p;
+
+	if (kind == Q_RANGE)
+	{
+		if (!valid_date(d1) || !valid_date(d2)) return;
+
+		out_reserve(o, OUT_LINE_MAX);
+		p = put_int(o.p, BizDaysBetween(c, d1, d2));
+		p = put_mem(p, " business days from ", 20);
+		p = put_month_date_year(p, d1);
+		p = put_mem(p, " to ", 4);
+		p = put_month_date_year(p, d2);
+		o.p = put_mem(p, ".\n", 2);
+		return;
+	}
+
+	if (kind == Q_ADD)
+	{
+		if (!valid_date(d1)) return;
+
+		out_reserve(o, OUT_LINE_MAX);
+		p = put_int(o.p, k);
+		p = put_mem(p, " business days after ", 21);
+		p = put_month_date_year(p, d1);
+		p = put_mem(p, " is ", 4);
+		p = put_month_date_year(p, BizDaysAdd(c, d1, k));
+		o.p = put_mem(p, ".\n", 2);
+		return;
+	}
+
+	if (kind == Q_WEEKDAY)
+	{
+		if (!valid_date(d1)) return;
+
+		out_reserve(o, OUT_LINE_MAX);
+		p = put_month_date_year(o.p, d1);
+		if (biz_is_workday(c, DateToSerial(d1))) p = put_mem(p, " is a business day.\n", 20);
+		else p = put_mem(p, " is not a business day.\n", 24);
+		o.p = p;
+	}
+}
+
+struct biz_sink
+{
+	out_buf *o;
+	const biz_cal *c;
+};
+
+static void format_line_biz(const char *s, const char *end, void *ctx)
+{
+	biz_sink &b = *(biz_sink *)ctx;
+	date d1, d2;
+	int k = 0;
+	int kind = classify_line_fast(s, end, d1, d2, k);
+	format_biz_query(*b.o, *b.c, kind, d1, d2, k);
+}
+
+// ============================================================
+// 效能測試：./p1 --bench=名稱 [筆數]；不帶參數時照常讀 stdin 做作業規定的輸出
+// ============================================================
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// xorshift64：benchmark 用的亂數，固定種子讓每次跑的輸入都一樣。
+static uint64_t g_rng = 88172645463325252ULL;
+
+static uint64_t rng_next(void)
+{
+	g_rng ^= g_rng << 13;
+	g_rng ^= g_rng >> 7;
+	g_rng ^= g_rng << 17;
+	return g_rng;
+}
+
+// 產生 1..9999 年之間的合法日期
+static void random_dates(date_soa &out, const size_t n)
+{
+	static const int md[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+
+	for (size_t i = 0; i < n; i++)
+	{
+		int y = 1 + (int)(rng_next() % 9999);
+		int m = 1 + (int)(rng_next() % 12);
+		int lim = md[m - 1] + (m == 2 && is_leap(y));
+		out.y[i] = y;
+		out.m[i] = m;
+		out.d[i] = 1 + (int)(rng_next() % (uint64_t)lim);
+	}
+}
+
+static void bench_row(const char *name, const char *path, const size_t n, const double sec)
+{
+	std::printf("%-14s %-8s %10.2f ns/op %10.1f Mop/s\n", name, path, sec * 1e9 / (double)n, (double)n / sec / 1e6);
+}
+
+static int bench_batch(const size_t n)
+{
+	// 一次配好所有 int 欄位：a、b、輸出、參考答案各三條，外加 x 與兩條 DateSub 結果
+	int *buf = (int *) std::malloc(sizeof(int) * n * 15);
+	int64_t *jr = (int64_t *) std::malloc(sizeof(int64_t) * n);
+	int64_t *jb = (int64_t *) std::malloc(sizeof(int64_t) * n);
+	const char **wr = (const char **) std::malloc(sizeof(const char *) * n);
+	const char **wb = (const char **) std::malloc(sizeof(const char *) * n);
+	if (!buf || !jr || !jb || !wr || !wb)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+
+	date_soa a = { buf, buf + n, buf + 2 * n };
+	date_soa b = { buf + 3 * n, buf + 4 * n, buf + 5 * n };
+	date_soa o = { buf + 6 * n, buf + 7 * n, buf + 8 * n };
+	date_soa ref = { buf + 9 * n, buf + 10 * n, buf + 11 * n };
+	int *x = buf + 12 * n;
+	int *sub_ref = buf + 13 * n;
+	int *sub_out = buf + 14 * n;
+
+	random_dates(a, n);
+	random_dates(b, n);
+	for (size_t i = 0; i < n; i++)
+		x[i] = (int)(rng_next() % 2000001) - 1000000;
+
+	std::printf("批次 JDN 轉換：n = %zu\n", n);
+	std::printf("-------------------------------------------------------------\n");
+
+	// 純量基準：一筆一筆呼叫原本的函式
+	double t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		jr[i] = DateToSerial(date{a.y[i], a.m[i], a.d[i]});
+	bench_row("DateToSerial", "per-call", n, now_sec() - t0);
+
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+	{
+		date t = DateAdd(date{a.y[i], a.m[i], a.d[i]}, x[i]);
+		ref.y[i] = t.y; ref.m[i] = t.m; ref.d[i] = t.d;
+	}
+	bench_row("DateAdd", "per-call", n, now_sec() - t0);
+
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		sub_ref[i] = DateSub(date{a.y[i], a.m[i], a.d[i]}, date{b.y[i], b.m[i], b.d[i]});
+	bench_row("DateSub", "per-call", n, now_sec() - t0);
+
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		wr[i] = DayOfWeek(date{a.y[i], a.m[i], a.d[i]});
+	bench_row("DayOfWeek", "per-call", n, now_sec() - t0);
+
+	// 每一種 CPU 支援的路徑都跑一次，並且跟純量結果逐筆比對
+	int best = simd_level();
+	int bad = 0;
+	for (int lv = SIMD_SCALAR; lv <= best; lv++)
+	{
+		g_simd_level = lv;
+
+		t0 = now_sec();
+		DateToSerialBatch(a, jb, n);
+		bench_row("DateToSerial", SIMD_NAMES[lv], n, now_sec() - t0);
+		if (std::memcmp(jb, jr, sizeof(int64_t) * n) != 0) bad = 1;
+
+		t0 = now_sec();
+		DateAddBatch(a, x, o, n);
+		bench_row("DateAdd", SIMD_NAMES[lv], n, now_sec() - t0);
+		for (size_t i = 0; i < n; i++)
+			if (o.y[i] != ref.y[i] || o.m[i] != ref.m[i] || o.d[i] != ref.d[i]) bad = 1;
+
+		t0 = now_sec();
+		DateSubBatch(a, b, sub_out, n);
+		bench_row("DateSub", SIMD_NAMES[lv], n, now_sec() - t0);
+		if (std::memcmp(sub_out, sub_ref, sizeof(int) * n) != 0) bad = 1;
+
+		t0 = now_sec();
+		DayOfWeekBatch(a, wb, n);
+		bench_row("DayOfWeek", SIMD_NAMES[lv], n, now_sec() - t0);
+		if (std::memcmp(wb, wr, sizeof(const char *) * n) != 0) bad = 1;
+	}
+	g_simd_level = best;
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("批次結果與逐筆呼叫%s\n", bad ? "不一致！" : "完全一致");
+
+	std::free(wb);
+	std::free(wr);
+	std::free(jb);
+	std::free(jr);
+	std::free(buf);
+	return bad;
+}
+
+// 產生 n 行三種查詢混在一起的輸入（區間、加法、單日各約三分之一），寫進暫存檔
+static FILE *random_query_file(const size_t n)
+{
+	FILE *f = std::tmpfile();
+	if (!f) return NULL;
+
+	int y[2], m[2], d[2];
+	date_soa q = { y, m, d };
+	for (size_t i = 0; i < n; i++)
+	{
+		random_dates(q, 2);
+		switch (rng_next() % 3)
+		{
+		case 0:  std::fprintf(f, "%d/%d/%d - %d/%d/%d\n", y[0], m[0], d[0], y[1], m[1], d[1]); break;
+		case 1:  std::fprintf(f, "%d/%d/%d + %d\n", y[0], m[0], d[0], (int)(rng_next() % 200001) - 100000); break;
+		default: std::fprintf(f, "%d/%d/%d\n", y[0], m[0], d[0]); break;
+		}
+	}
+	std::fflush(f);
+	return f;
+}
+
+// 解析結果的摘要：各類行數加上欄位的雜湊，用來確認兩條路徑讀到的東西一樣
+struct parse_tally
+{
+	size_t count[4];
+	uint64_t sum;
+};
+
+static void tally_query(parse_tally *t, const int kind, const date &d1, const date &d2, const int k)
+{
+	t->count[kind]++;
+	if (kind == Q_NONE) return;
+	uint64_t h = (uint64_t)(uint32_t)d1.y * 31 + (uint64_t)(d1.m * 37 + d1.d);
+	if (kind == Q_RANGE) h = h * 1000003 + (uint64_t)(uint32_t)d2.y * 31 + (uint64_t)(d2.m * 37 + d2.d);
+	if (kind == Q_ADD) h = h * 1000003 + (uint64_t)(uint32_t)k;
+	t->sum = t->sum * 0x9E3779B97F4A7C15ULL + h;
+}
+
+static void tally_line_fast(const char *s, const char *end, void *ctx)
+{
+	date d1, d2;
+	int k = 0;
+	int kind = classify_line_fast(s, end, d1, d2, k);
+	tally_query((parse_tally *)ctx, kind, d1, d2, k);
+}
+
+static void bench_lines_row(const char *path, const size_t n, const double sec)
+{
+	std::printf("%-20s %10.3f 秒 %12.0f lines/s %8.1f ns/line\n", path, sec, (double)n / sec, sec * 1e9 / (double)n);
+}
+
+static int bench_parse(const size_t n)
+{
+	FILE *f = random_query_file(n);
+	if (!f)
+	{
+		std::fprintf(stderr, "無法建立暫存檔！\n");
+		return 1;
+	}
+
+	std::printf("輸入解析：n = %zu 行\n", n);
+	std::printf("-------------------------------------------------------------\n");
+
+	// 原本的作法：fgets + 最多三次 sscanf
+	parse_tally ref;
+	std::memset(&ref, 0, sizeof(ref));
+	std::rewind(f);
+	char buf[256];
+	date d1, d2;
+	int k = 0;
+	double t0 = now_sec();
+	while (std::fgets(buf, sizeof(buf), f))
+	{
+		int kind = classify_line_sscanf(buf, d1, d2, k);
+		tally_query(&ref, kind, d1, d2, k);
+	}
+	bench_lines_row("fgets+sscanf", n, now_sec() - t0);
+
+	// 串流版：mmap 與區塊 read() 各跑一次
+	int bad = 0;
+	for (int use_mmap = 1; use_mmap >= 0; use_mmap--)
+	{
+		parse_tally t;
+		std::memset(&t, 0, sizeof(t));
+		lseek(fileno(f), 0, SEEK_SET);
+		t0 = now_sec();
+		stream_fd(fileno(f), use_mmap, tally_line_fast, &t);
+		bench_lines_row(use_mmap ? "mmap+scanner" : "read(1MiB)+scanner", n, now_sec() - t0);
+		if (std::memcmp(&t, &ref, sizeof(t)) != 0) bad = 1;
+	}
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("解析結果%s\n", bad ? "不一致！" : "完全一致");
+	std::fclose(f);
+	return bad;
+}
+
+// 把 stdout 暫時導到 fd，讓 printf 版本的輸出也能量測與比對
+static int redirect_stdout(const int fd)
+{
+	std::fflush(stdout);
+	int saved = dup(1);
+	dup2(fd, 1);
+	return saved;
+}
+
+static void restore_stdout(const int saved)
+{
+	std::fflush(stdout);
+	dup2(saved, 1);
+	close(saved);
+}
+
+static int same_file_content(FILE *a, FILE *b)
+{
+	char ba[1 << 14], bb[1 << 14];
+	std::rewind(a);
+	std::rewind(b);
+	for (;;)
+	{
+		size_t na = std::fread(ba, 1, sizeof(ba), a);
+		size_t nb = std::fread(bb, 1, sizeof(bb), b);
+		if (na != nb || std::memcmp(ba, bb, na) != 0) return 0;
+		if (na == 0) return 1;
+	}
+}
+
+static int bench_format(const size_t n)
+{
+	int *buf = (int *) std::malloc(sizeof(int) * n * 8);
+	FILE *fa = std::tmpfile();
+	FILE *fb = std::tmpfile();
+	if (!buf || !fa || !fb)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+
+	date_soa a = { buf, buf + n, buf + 2 * n };
+	date_soa b = { buf + 3 * n, buf + 4 * n, buf + 5 * n };
+	int *x = buf + 6 * n;
+	int *kind = buf + 7 * n;
+	random_dates(a, n);
+	random_dates(b, n);
+	for (size_t i = 0; i < n; i++)
+	{
+		x[i] = (int)(rng_next() % 200001) - 100000;
+		kind[i] = Q_RANGE + (int)(rng_next() % 3);
+	}
+
+	std::printf("輸出格式化：n = %zu 行\n", n);
+	std::printf("-------------------------------------------------------------\n");
+
+	int saved = redirect_stdout(fileno(fa));
+	double t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		answer_query(kind[i], date{a.y[i], a.m[i], a.d[i]}, date{b.y[i], b.m[i], b.d[i]}, x[i]);
+	std::fflush(stdout);
+	double t_printf = now_sec() - t0;
+	restore_stdout(saved);
+
+	out_buf o;
+	out_init(o, fb, OUT_BLOCK);
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		format_query(o, kind[i], date{a.y[i], a.m[i], a.d[i]}, date{b.y[i], b.m[i], b.d[i]}, x[i]);
+	out_flush(o);
+	std::fflush(fb);
+	double t_buf = now_sec() - t0;
+	out_free(o);
+
+	bench_lines_row("printf", n, t_printf);
+	bench_lines_row("out_buf", n, t_buf);
+
+	int bad = !same_file_content(fa, fb);
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("兩種輸出%s\n", bad ? "不一致！" : "逐位元組相同");
+	std::fclose(fa);
+	std::fclose(fb);
+	std::free(buf);
+	return bad;
+}
+
+// --threads=N 同時也是 bench_threads 掃描的上限
+static int g_threads = 0;
+
+static int bench_threads(const size_t n)
+{
+	FILE *f = random_query_file(n);
+	FILE *ref = std::tmpfile();
+	FILE *par = std::tmpfile();
+	FILE *null = std::fopen("/dev/null", "w");
+	if (!f || !ref || !par || !null)
+	{
+		std::fprintf(stderr, "無法建立暫存檔！\n");
+		return 1;
+	}
+	int max = g_threads > 0 ? g_threads : online_cpus();
+
+	std::printf("多執行緒管線：n = %zu 行，最多 %d 個執行緒（線上 CPU %d 個）\n", n, max, online_cpus());
+	std::printf("-------------------------------------------------------------\n");
+
+	// 基準：單執行緒的 --stream --fastout
+	out_buf o;
+	out_init(o, null, OUT_BLOCK);
+	lseek(fileno(f), 0, SEEK_SET);
+	double t0 = now_sec();
+	stream_fd(fileno(f), 1, format_line_fast, &o);
+	out_flush(o);
+	double base = now_sec() - t0;
+	out_free(o);
+	std::printf("%-12s %10.3f 秒 %12.0f lines/s\n", "sequential", base, (double)n / base);
+
+	for (int t = 1; t <= max; t = (t < max && t * 2 > max) ? max : t * 2)
+	{
+		lseek(fileno(f), 0, SEEK_SET);
+		t0 = now_sec();
+		run_parallel(fileno(f), t, null);
+		std::fflush(null);
+		double sec = now_sec() - t0;
+		std::printf("threads=%-4d %10.3f 秒 %12.0f lines/s   speedup %5.2fx\n", t, sec, (double)n / sec, base / sec);
+		if (t == max) break;
+	}
+
+	// 最多執行緒的輸出必須跟單執行緒版一模一樣
+	out_init(o, ref, OUT_BLOCK);
+	lseek(fileno(f), 0, SEEK_SET);
+	stream_fd(fileno(f), 1, format_line_fast, &o);
+	out_free(o);
+	std::fflush(ref);
+	lseek(fileno(f), 0, SEEK_SET);
+	run_parallel(fileno(f), max, par);
+	std::fflush(par);
+	int bad = !same_file_content(ref, par);
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("平行輸出%s\n", bad ? "與單執行緒版不一致！" : "與單執行緒版逐位元組相同");
+	std::fclose(null);
+	std::fclose(par);
+	std::fclose(ref);
+	std::fclose(f);
+	return bad;
+}
+
+// 時間戳記計數器：x86 上用 rdtsc 換算每次轉換花幾個（參考）週期，其他平台只報 ns
+static inline uint64_t cycles_now(void)
+{
+#if P1_X86_SIMD
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void bench_cycles_row(const char *name, const char *path, const size_t n, const double sec, const uint64_t cyc)
+{
+	std::printf("%-14s %-10s %8.2f ns/op %8.1f cycles/op\n", name, path, sec * 1e9 / (double)n, (double)cyc / (double)n);
+}
+
+static int bench_table(const size_t n)
+{
+	int *buf = (int *) std::malloc(sizeof(int) * n * 3);
+	int64_t *j = (int64_t *) std::malloc(sizeof(int64_t) * n);
+	if (!buf || !j)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+
+	date_soa a = { buf, buf + n, buf + 2 * n };
+	random_dates(a, n);
+	for (size_t i = 0; i < n; i++)
+	{
+		// 全部落在 1900..2100；2/29 落在平年時順手改成 2/28
+		a.y[i] = TABLE_Y0 + a.y[i] % TABLE_YEARS;
+		if (a.m[i] == 2 && a.d[i] == 29 && !is_leap(a.y[i])) a.d[i] = 28;
+		j[i] = to_jdn(a.y[i], a.m[i], a.d[i]);
+	}
+
+	std::printf("查表（%d..%d）對上公式：n = %zu\n", TABLE_Y0, TABLE_Y1, n);
+	std::printf("-------------------------------------------------------------\n");
+
+	// 每一項都把結果累加起來，避免編譯器把迴圈整個丟掉
+	uint64_t sink[2][4] = {};
+	for (int use_table = 1; use_table >= 0; use_table--)
+	{
+		const char *path = use_table ? "table" : "formula";
+		uint64_t *acc = sink[use_table];
+
+		double t0 = now_sec();
+		uint64_t c0 = cycles_now();
+		for (size_t i = 0; i < n; i++)
+			acc[0] += (uint64_t)(use_table ? cal_to_serial(cal_year(a.y[i]), a.m[i], a.d[i]) : to_jdn(a.y[i], a.m[i], a.d[i]));
+		bench_cycles_row("DateToSerial", path, n, now_sec() - t0, cycles_now() - c0);
+
+		t0 = now_sec();
+		c0 = cycles_now();
+		for (size_t i = 0; i < n; i++)
+		{
+			date t;
+			if (use_table) t = cal_from_serial(j[i]);
+			else from_jdn(j[i], t.y, t.m, t.d);
+			acc[1] += (uint64_t)(t.y * 500 + t.m * 40 + t.d);
+		}
+		bench_cycles_row("SerialToDate", path, n, now_sec() - t0, cycles_now() - c0);
+
+		t0 = now_sec();
+		c0 = cycles_now();
+		for (size_t i = 0; i < n; i++)
+		{
+			date t = { a.y[i], a.m[i], a.d[i] + (int)(i & 3) };	// 混一些不合法的日
+			acc[2] += (uint64_t)(use_table ? (t.d >= 1 && t.d <= cal_month_days(cal_year(t.y), t.m)) : valid_date_rule(t));
+		}
+		bench_cycles_row("valid_date", path, n, now_sec() - t0, cycles_now() - c0);
+
+		t0 = now_sec();
+		c0 = cycles_now();
+		for (size_t i = 0; i < n; i++)
+		{
+			if (use_table) acc[3] += (uint64_t)cal_weekday(cal_year(a.y[i]), a.m[i], a.d[i]);
+			else
+			{
+				int64_t jj = to_jdn(a.y[i], a.m[i], a.d[i]);
+				acc[3] += (uint64_t)(((int)((jj % 7 + 7) % 7) + 1) % 7);
+			}
+		}
+		bench_cycles_row("DayOfWeek", path, n, now_sec() - t0, cycles_now() - c0);
+	}
+
+	int bad = std::memcmp(sink[0], sink[1], sizeof(sink[0])) != 0;
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("兩條路徑的結果%s\n", bad ? "不一致！" : "完全一致");
+	std::free(j);
+	std::free(buf);
+	return bad;
+}
+
+// 有重複的查詢流：先產生 distinct 種不同的行，再用偏斜的分佈抽 n 次（越前面的越常出現）
+static FILE *repeated_query_file(const size_t n, const size_t distinct)
+{
+	FILE *pool = random_query_file(distinct);
+	FILE *f = std::tmpfile();
+	char **line = (char **) std::malloc(sizeof(char *) * distinct);
+	if (!pool || !f || !line) return NULL;
+
+	char buf[256];
+	size_t u = 0;
+	std::rewind(pool);
+	while (u < distinct && std::fgets(buf, sizeof(buf), pool))
+		line[u++] = strdup(buf);
+	std::fclose(pool);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		double r = (double)(rng_next() >> 11) / 9007199254740992.0;
+		std::fputs(line[(size_t)(r * r * r * (double)u)], f);
+	}
+	for (size_t i = 0; i < u; i++)
+		std::free(line[i]);
+	std::free(line);
+	std::fflush(f);
+	return f;
+}
+
+static int bench_cache(const size_t n)
+{
+	size_t distinct = n / 256 + 1;
+	FILE *f = repeated_query_file(n, distinct);
+	FILE *ref = std::tmpfile();
+	FILE *got = std::tmpfile();
+	if (!f || !ref || !got)
+	{
+		std::fprintf(stderr, "無法建立暫存檔！\n");
+		return 1;
+	}
+
+	std::printf("查詢結果快取：n = %zu 行，%zu 種不同的查詢\n", n, distinct);
+	std::printf("-------------------------------------------------------------\n");
+
+	out_buf o;
+	out_init(o, ref, OUT_BLOCK);
+	lseek(fileno(f), 0, SEEK_SET);
+	double t0 = now_sec();
+	stream_fd(fileno(f), 1, format_line_fast, &o);
+	out_flush(o);
+	double base = now_sec() - t0;
+	out_free(o);
+	std::fflush(ref);
+	std::printf("%-16s %10.3f 秒 %12.0f lines/s\n", "no cache", base, (double)n / base);
+
+	int bad = 0;
+	const size_t caps[] = { distinct / 64 + 1, distinct / 8 + 1, distinct + 1 };
+	for (size_t k = 0; k < sizeof(caps) / sizeof(caps[0]); k++)
+	{
+		query_cache c;
+		if (qc_init(c, (int)caps[k]) < 0)
+		{
+			std::fprintf(stderr, "記憶體配置失敗！\n");
+			return 1;
+		}
+		std::fflush(got);
+		if (ftruncate(fileno(got), 0) != 0) return 1;
+		std::rewind(got);
+
+		out_init(o, got, OUT_BLOCK);
+		cached_sink cs = { &o, &c };
+		lseek(fileno(f), 0, SEEK_SET);
+		t0 = now_sec();
+		stream_fd(fileno(f), 1, format_line_cached, &cs);
+		out_flush(o);
+		double sec = now_sec() - t0;
+		out_free(o);
+		std::fflush(got);
+
+		char label[32];
+		std::snprintf(label, sizeof(label), "cache=%zu", caps[k]);
+		std::printf("%-16s %10.3f 秒 %12.0f lines/s   hit %6.2f%%  speedup %5.2fx\n", label, sec, (double)n / sec,
+		            100.0 * (double)c.hits / (double)(c.hits + c.misses), base / sec);
+		if (!same_file_content(ref, got)) bad = 1;
+		qc_free(c);
+	}
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("快取輸出%s\n", bad ? "與未快取時不一致！" : "與未快取時逐位元組相同");
+	std::fclose(got);
+	std::fclose(ref);
+	std::fclose(f);
+	return bad;
+}
+
+static int bench_range(const size_t n)
+{
+	date *ref = (date *) std::malloc(sizeof(date) * n);
+	date *got = (date *) std::malloc(sizeof(date) * n);
+	int *buf = (int *) std::malloc(sizeof(int) * n * 3);
+	if (!ref || !got || !buf)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+
+	const date start = { 1970, 1, 31 };
+	int bad = 0;
+
+	// 先把每一頁都摸過一次，計時裡才不會混進第一次寫入的 page fault
+	std::memset(ref, 0, sizeof(date) * n);
+	std::memset(got, 0, sizeof(date) * n);
+	std::memset(buf, 0, sizeof(int) * n * 3);
+
+	std::printf("日期區間走訪：n = %zu 步，起點 %d/%d/%d\n", n, start.y, start.m, start.d);
+	std::printf("-------------------------------------------------------------\n");
+
+	// 連續 n 天
+	double t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		ref[i] = DateAdd(start, (int)i);
+	bench_row("day", "DateAdd", n, now_sec() - t0);
+
+	t0 = now_sec();
+	DateFill(start, got, n);
+	bench_row("day", "DateFill", n, now_sec() - t0);
+	if (std::memcmp(ref, got, sizeof(date) * n) != 0) bad = 1;
+
+	date_soa soa = { buf, buf + n, buf + 2 * n };
+	t0 = now_sec();
+	DateFillBatch(start, soa, n);
+	bench_row("day", "FillSoA", n, now_sec() - t0);
+	for (size_t i = 0; i < n; i++)
+		if (soa.y[i] != ref[i].y || soa.m[i] != ref[i].m || soa.d[i] != ref[i].d) bad = 1;
+
+	// 每週同一天
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		ref[i] = DateAdd(start, (int)(7 * i));
+	bench_row("week", "DateAdd", n, now_sec() - t0);
+
+	date_iter it;
+	t0 = now_sec();
+	date_iter_init(it, start, STEP_WEEK, 1);
+	for (size_t i = 0; i < n; i++, date_iter_next(it))
+		got[i] = it.cur;
+	bench_row("week", "iterator", n, now_sec() - t0);
+	if (std::memcmp(ref, got, sizeof(date) * n) != 0) bad = 1;
+
+	// 每個月同一號（月底夾擠）：對照組是直接算年月、再把日往回夾到合法
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+	{
+		int64_t m0 = start.m - 1 + (int64_t)i;
+		date t = { start.y + (int)(m0 / 12), (int)(m0 % 12) + 1, start.d };
+		while (!valid_date_rule(t)) t.d--;
+		ref[i] = t;
+	}
+	bench_row("month", "recompute", n, now_sec() - t0);
+
+	t0 = now_sec();
+	date_iter_init(it, start, STEP_MONTH, 1);
+	for (size_t i = 0; i < n; i++, date_iter_next(it))
+		got[i] = it.cur;
+	bench_row("month", "iterator", n, now_sec() - t0);
+	if (std::memcmp(ref, got, sizeof(date) * n) != 0) bad = 1;
+
+	// 區間 API：2000..2099 每隔兩週的星期五，個數要跟直接算的一致
+	const date from = { 2000, 1, 1 }, to = { 2099, 12, 31 };
+	size_t cnt = DateRangeWeekday(from, to, 5, 2, got, n);
+	size_t expect = (size_t)(DateSub(DateAdd(from, 6), to) / 14 + 1);	// 2000/1/1 是星期六，第一個星期五在 6 天後
+	if (cnt != expect) bad = 1;
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("走訪結果%s\n", bad ? "與逐次計算不一致！" : "與逐次計算完全一致");
+	std::free(buf);
+	std::free(got);
+	std::free(ref);
+	return bad;
+}
+
+static void bench_speedup_row(const char *path, const size_t n, const double sec, const double base)
+{
+	std::printf("%-20s %10.3f 秒 %12.0f lines/s %8.1f ns/line %6.1fx\n", path, sec, (double)n / sec, sec * 1e9 / (double)n, base / sec);
+}
+
+// 文字查詢檔一次轉成兩種二進位編碼，比較「讀文字寫句子」與「讀二進位寫句子／寫二進位答案」
+static int bench_binary(const size_t n)
+{
+	static const char *LAYOUT_NAMES[2] = { "packed", "serial" };
+	FILE *ft = random_query_file(n);
+	FILE *ref = std::tmpfile();
+	FILE *fq[2] = { std::tmpfile(), std::tmpfile() };
+	FILE *fa[2] = { std::tmpfile(), std::tmpfile() };
+	FILE *fo = std::tmpfile();
+	if (!ft || !ref || !fq[0] || !fq[1] || !fa[0] || !fa[1] || !fo)
+	{
+		std::fprintf(stderr, "無法建立暫存檔！\n");
+		return 1;
+	}
+
+	std::printf("二進位欄式格式：n = %zu 筆查詢\n", n);
+	std::printf("-------------------------------------------------------------\n");
+
+	// 基準：目前最快的文字路徑（mmap + 手寫掃描器 + out_buf）
+	out_buf o;
+	out_init(o, ref, OUT_BLOCK);
+	lseek(fileno(ft), 0, SEEK_SET);
+	double t0 = now_sec();
+	stream_fd(fileno(ft), 1, format_line_fast, &o);
+	out_flush(o);
+	std::fflush(ref);
+	double t_text = now_sec() - t0;
+	out_free(o);
+	bench_lines_row("text → text", n, t_text);
+
+	int bad = 0;
+	for (int layout = BIN_PACKED; layout <= BIN_SERIAL; layout++)
+	{
+		char name[40];
+		size_t skipped = 0;
+		lseek(fileno(ft), 0, SEEK_SET);
+		t0 = now_sec();
+		text_to_bin(fileno(ft), fq[layout], layout, skipped);
+		std::snprintf(name, sizeof(name), "text → %s", LAYOUT_NAMES[layout]);
+		bench_lines_row(name, n, now_sec() - t0);
+		if (skipped) bad = 1;
+
+		std::rewind(fq[layout]);
+		std::rewind(fo);
+		t0 = now_sec();
+		run_binary(fq[layout], fo, 0);
+		double t = now_sec() - t0;
+		std::snprintf(name, sizeof(name), "%s → text", LAYOUT_NAMES[layout]);
+		bench_speedup_row(name, n, t, t_text);
+		if (!same_file_content(ref, fo)) bad = 1;
+
+		std::rewind(fq[layout]);
+		t0 = now_sec();
+		run_binary(fq[layout], fa[layout], 1);
+		t = now_sec() - t0;
+		std::snprintf(name, sizeof(name), "%s → %s", LAYOUT_NAMES[layout], LAYOUT_NAMES[layout]);
+		bench_speedup_row(name, n, t, t_text);
+	}
+
+	// 兩種編碼的答案要一致：天數與星期幾相同，加法的結果是同一天
+	bin_block *a = bin_block_new(), *b = bin_block_new();
+	int la, lb;
+	std::rewind(fa[0]);
+	std::rewind(fa[1]);
+	if (!bin_read_header(fa[0], BIN_MAGIC_ANSWER, la) || !bin_read_header(fa[1], BIN_MAGIC_ANSWER, lb)) bad = 1;
+	size_t total = 0;
+	while (!bad && bin_read_block(fa[0], *a, 1) > 0)
+	{
+		if (bin_read_block(fa[1], *b, 1) <= 0 || a->n != b->n) bad = 1;
+		for (uint32_t i = 0; !bad && i < a->n; i++)
+		{
+			date x, y;
+			if (a->kind[i] != b->kind[i]) bad = 1;
+			else if (a->kind[i] != Q_ADD) bad = a->a[i] != b->a[i];
+			else bad = !bin_decode(la, a->a[i], x) || !bin_decode(lb, b->a[i], y) || x.y != y.y || x.m != y.m || x.d != y.d;
+		}
+		total += a->n;
+	}
+	if (total != n) bad = 1;
+	std::free(a);
+	std::free(b);
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("二進位輸入的句子與文字模式%s\n", bad ? "不一致！" : "逐位元組相同，兩種編碼的答案一致");
+	std::fclose(ft);
+	std::fclose(ref);
+	std::fclose(fo);
+	for (int i = 0; i < 2; i++)
+	{
+		std::fclose(fq[i]);
+		std::fclose(fa[i]);
+	}
+	return bad;
+}
+
+// 逐日走的參考答案，只拿來驗證
+static int naive_is_workday(const int64_t *hol, const size_t nh, const int64_t s)
+{
+	return is_weekday_serial(s) && !std::bsearch(&s, hol, nh, sizeof(int64_t), cmp_i64);
+}
+
+static int64_t naive_biz_add(const int64_t *hol, const size_t nh, int64_t s, int n)
+{
+	int dir = n > 0 ? 1 : -1;
+	while (n != 0)
+	{
+		s += dir;
+		if (naive_is_workday(hol, nh, s)) n -= dir;
+	}
+	return s;
+}
+
+static int64_t naive_biz_between(const int64_t *hol, const size_t nh, const int64_t a, const int64_t b)
+{
+	int64_t lo = a < b ? a : b, hi = a < b ? b : a, cnt = 0;
+	for (int64_t s = lo; s < hi; s++)
+		cnt += naive_is_workday(hol, nh, s);
+	return a < b ? cnt : -cnt;
+}
+
+static int bench_business(const size_t n)
+{
+	// 1900..2100 每年六個固定假日再加五天隨機的
+	static const int FIXED[6][2] = { {1, 1}, {2, 28}, {4, 4}, {5, 1}, {10, 10}, {12, 25} };
+	size_t nh = 0;
+	int64_t *hs = (int64_t *) std::malloc(sizeof(int64_t) * 201 * 11);
+	date *q = (date *) std::malloc(sizeof(date) * n * 2);
+	int *x = (int *) std::malloc(sizeof(int) * n);
+	if (!hs || !q || !x)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+	for (int y = 1900; y <= 2100; y++)
+	{
+		for (int i = 0; i < 6; i++)
+			hs[nh++] = DateToSerial(date{y, FIXED[i][0], FIXED[i][1]});
+		for (int i = 0; i < 5; i++)
+			hs[nh++] = DateToSerial(date{y, 1, 1}) + (int64_t)(rng_next() % 365);
+	}
+
+	biz_cal c;
+	if (biz_init(c, hs, nh) < 0)
+	{
+		std::fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+
+	// 日期散在 1850..2150，一半的 N 很大（跨過整個假日表），一半在幾年以內
+	int64_t lo = DateToSerial(date{1850, 1, 1}), span = DateToSerial(date{2150, 1, 1}) - lo;
+	for (size_t i = 0; i < n; i++)
+	{
+		q[2 * i] = SerialToDate(lo + (int64_t)(rng_next() % (uint64_t)span));
+		q[2 * i + 1] = SerialToDate(lo + (int64_t)(rng_next() % (uint64_t)span));
+		x[i] = (i & 1) ? (int)(rng_next() % 2000001) - 1000000 : (int)(rng_next() % 2001) - 1000;
+	}
+
+	std::printf("工作日運算：n = %zu，平日假日 %zu 天（1900..2100）\n", n, c.nh);
+	std::printf("-------------------------------------------------------------\n");
+
+	int64_t sink = 0;
+	double t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		sink += DateAdd(q[2 * i], x[i]).d;
+	bench_row("DateAdd", "", n, now_sec() - t0);
+
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		sink += BizDaysAdd(c, q[2 * i], x[i]).d;
+	bench_row("BizDaysAdd", "前綴計數", n, now_sec() - t0);
+
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		sink += DateSub(q[2 * i], q[2 * i + 1]);
+	bench_row("DateSub", "", n, now_sec() - t0);
+
+	t0 = now_sec();
+	for (size_t i = 0; i < n; i++)
+		sink += BizDaysBetween(c, q[2 * i], q[2 * i + 1]);
+	bench_row("BizDaysBetween", "前綴計數", n, now_sec() - t0);
+
+	// 逐日走太慢，只抽前面一小段、N 也限制在幾千天內對答案
+	size_t check = n < 2000 ? n : 2000;
+	int bad = 0;
+	for (size_t i = 0; i < check && !bad; i++)
+	{
+		int64_t s = DateToSerial(q[2 * i]);
+		int k = x[i] % 3000;
+		int64_t e = s + (int64_t)(rng_next() % 6001) - 3000;
+		if (k != 0 && DateToSerial(BizDaysAdd(c, q[2 * i], k)) != naive_biz_add(c.hol, c.nh, s, k)) bad = 1;
+		if (BizDaysBetween(c, q[2 * i], SerialToDate(e)) != naive_biz_between(c.hol, c.nh, s, e)) bad = 1;
+	}
+
+	std::printf("-------------------------------------------------------------\n");
+	std::printf("抽查 %zu 筆與逐日走的結果%s（checksum %lld）\n", check, bad ? "不一致！" : "一致", (long long)sink);
+	biz_free(c);
+	std::free(hs);
+	std::free(q);
+	std::free(x);
+	return bad;
+}
+
+// benchmark 登記表：新增項目只要往這裡加一列
+struct bench_entry
+{
+	const char *name;
+	int (*run)(const size_t n);
+	size_t default_n;
+	const char *desc;
+};
+
+static const bench_entry BENCHES[] = {
+	{ "batch", bench_batch, (size_t)1 << 22, "逐筆 DateToSerial/DateAdd/DateSub/DayOfWeek 對上批次 SIMD 版本" },
+	{ "parse", bench_parse, (size_t)1 << 22, "fgets+sscanf 對上 mmap／區塊讀取＋手寫掃描器（lines/s）" },
+	{ "format", bench_format, (size_t)1 << 22, "逐欄 printf 對上緩衝輸出 out_buf（lines/s）" },
+	{ "table", bench_table, (size_t)1 << 23, "1900..2100 查表對上 Fliegel–Van Flandern 公式（cycles/op）" },
+	{ "range", bench_range, (size_t)1 << 22, "DateFill／走訪器（日、週、月步進）對上重複呼叫 DateAdd" },
+	{ "binary", bench_binary, (size_t)1 << 22, "文字查詢對上二進位欄式格式（packed／serial；輸出句子或二進位答案）" },
+	{ "business", bench_business, (size_t)1 << 22, "工作日加減（假日表＋前綴計數）對上一般的 DateAdd／DateSub" },
+	{ "cache", bench_cache, (size_t)1 << 22, "重複查詢流上，不同容量的結果快取對上不快取（命中率、lines/s）" },
+	{ "threads", bench_threads, (size_t)1 << 23, "多執行緒管線從 1 到 N 個執行緒的擴展性（N 由 --threads 指定）" },
+};
+
+static int run_bench(const char *name, const char *count)
+{
+	for (size_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); i++)
+	{
+		if (std::strcmp(name, BENCHES[i].name) != 0) continue;
+		size_t n = BENCHES[i].default_n;
+		if (count) n = (size_t)std::strtoull(count, NULL, 10);
+		if (n == 0) n = 1;
+		return BENCHES[i].run(n);
+	}
+
+	std::fprintf(stderr, "未知的 benchmark：%s\n可用項目：\n", name);
+	for (size_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); i++)
+		std::fprintf(stderr, "  %-10s %s\n", BENCHES[i].name, BENCHES[i].desc);
+	return 2;
+}
+
+static void usage(const char *prog)
+{
+	std::fprintf(stderr, "用法：%s [--stream] [--fastout] [--threads=N] [--cache=容量] [--bench=名稱 [筆數]] < input\n"
+		"      %s --to-bin[=packed|serial] | --from-bin | --bin [--bin-out] < input > output\n"
+		"      %s --holidays=假日檔 < input\n"
+		"      --cache= 的容量最多 %d 筆（0 表示不用快取）\n", prog, prog, prog, QC_CAP_MAX);
+}
+
+int main(int ac, char *av[])
+{
+	// 命令列參數都是效能測試／大量資料用的開關；作業規定的用法（不帶參數）行為完全不變。
+	int stream = 0, fastout = 0, parallel = 0, cache_cap = 0;
+	int to_bin = -1, from_bin = 0, bin_in = 0, bin_out = 0;
+	const char *holidays = NULL;
+	const char *bench = NULL, *bench_n = NULL;
+	for (int i = 1; i < ac; i++)
+	{
+		if (std::strncmp(av[i], "--bench=", 8) == 0)
+		{
+			bench = av[i] + 8;
+			if (i + 1 < ac && av[i + 1][0] != '-') bench_n = av[++i];
+		}
+		else if (std::strcmp(av[i], "--stream") == 0)
+			stream = 1;
+		else if (std::strcmp(av[i], "--fastout") == 0)
+			fastout = 1;
+		else if (std::strncmp(av[i], "--cache=", 8) == 0)
+		{
+			cache_cap = std::atoi(av[i] + 8);
+			if (cache_cap < 0 || cache_cap > QC_CAP_MAX)
+			{
+				usage(av[0]);
+				return 2;
+			}
+		}
+		else if (std::strcmp(av[i], "--to-bin") == 0 || std::strcmp(av[i], "--to-bin=packed") == 0)
+			to_bin = BIN_PACKED;
+		else if (std::strcmp(av[i], "--to-bin=serial") == 0)
+			to_bin = BIN_SERIAL;
+		else if (std::strcmp(av[i], "--from-bin") == 0)
+			from_bin = 1;
+		else if (std::strcmp(av[i], "--bin") == 0)
+			bin_in = 1;
+		else if (std::strcmp(av[i], "--bin-out") == 0)
+			bin_in = bin_out = 1;
+		else if (std::strncmp(av[i], "--holidays=", 11) == 0)
+			holidays = av[i] + 11;
+		else if (std::strncmp(av[i], "--threads=", 10) == 0)
+		{
+			parallel = 1;
+			g_threads = std::atoi(av[i] + 10);
+		}
+		else
+		{
+			usage(av[0]);
+			return 2;
+		}
+	}
+	if (bench)
+		return run_bench(bench, bench_n);
+
+	// 二進位格式：轉換器與直接讀寫；略過的查詢數印到 stderr
+	if (to_bin >= 0)
+	{
+		size_t skipped = 0;
+		int rc = text_to_bin(0, stdout, to_bin, skipped);
+		if (skipped) std::fprintf(stderr, "有 %zu 筆查詢的日期超出這種編碼的範圍，沒有寫進去\n", skipped);
+		return rc < 0;
+	}
+	if (from_bin)
+		return bin_to_text(stdin, stdout) < 0;
+	if (bin_in)
+		return run_binary(stdin, stdout, bin_out) < 0;
+
+	// 工作日模式：同樣三種查詢，改算工作日；一律走串流輸入與緩衝輸出
+	if (holidays)
+	{
+		biz_cal c;
+		out_buf o;
+		if (biz_load(c, holidays) < 0) return 1;
+		out_init(o, stdout, OUT_BLOCK);
+		biz_sink bs = { &o, &c };
+		int rc = stream_fd(0, 1, format_line_biz, &bs);
+		out_free(o);
+		biz_free(c);
+		return rc < 0;
+	}
+
+	// I/O 走「多筆直到 EOF」：遵照官教授網站提供的範例程式碼的格式。
+	// 平行模式一定走串流輸入與緩衝輸出；--threads=0 代表用全部的 CPU。
+	if (parallel)
+		return run_parallel(0, g_threads > 0 ? g_threads : online_cpus(), stdout) < 0;
+
+	// 快取一律搭配串流輸入與緩衝輸出；命中統計印到 stderr，stdout 的內容不受影響
+	if (cache_cap > 0)
+	{
+		query_cache c;
+		out_buf o;
+		if (qc_init(c, cache_cap) < 0)
+		{
+			std::fprintf(stderr, "記憶體配置失敗！\n");
+			return 1;
+		}
+		out_init(o, stdout, OUT_BLOCK);
+		cached_sink cs = { &o, &c };
+		int rc = stream_fd(0, 1, format_line_cached, &cs);
+		out_free(o);
+		qc_report(c, stderr);
+		qc_free(c);
+		return rc < 0;
+	}
+
+	if (stream && !fastout)
+		return stream_fd(0, 1, answer_line_fast, NULL) < 0;
+
+	out_buf o;
+	if (fastout)
+	{
+		out_init(o, stdout, OUT_BLOCK);
+		if (stream)
+		{
+			int rc = stream_fd(0, 1, format_line_fast, &o);
+			out_free(o);
+			return rc < 0;
+		}
+	}
+
+	char buf[256];
+	date d1, d2;
+	int k = 0;
+
+	while (std::fgets(buf, sizeof(buf), stdin))
+	{
+		int kind = classify_line_sscanf(buf, d1, d2, k);
+		if (fastout) format_query(o, kind, d1, d2, k);
+		else answer_query(kind, d1, d2, k);
 	}
+	if (fastout) out_free(o);
 	return 0;
 }
@@ -1,5 +1,5 @@
 // 排序演算法效能比較
-// 實作五種排序演算法：插入、選擇、快速、合併、堆積排序
+// 實作五種排序演算法：插入、選擇、快速、合併、堆積排序，另外加上改良版本一起比較
 // 作者：蔡秀吉 (H. C. Tsai)
 // 電子信箱：hctsai@linux
 // date: 2025/09/20
@@ -8,31 +8,77 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>	// 平行排序用，編譯時記得加 -pthread
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>		// 外部排序的檔案 I/O
+#include <sys/stat.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <type_traits>	// 泛型排序的 static_assert
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// 排序網路的 AVX2 版本只在 x86 + GCC/Clang 底下編進來，其他平台一律走純量版本。
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define P2_X86_SIMD 1
+#else
+#define P2_X86_SIMD 0
+#endif
 
 // ============================================================
 // 資料結構與全域變數
 // ============================================================
 
 typedef struct {
-	char name[20];
+	char name[48];
 	double time;
 	int count;
+	const char *id;
+	double speedup;		// 對單執行緒基準的加速比；沒有基準時是 0
+	double min, mean, stddev;	// time 是中位數；count 是計時的次數
+	long long counters[4];	// perf 計數器（各次的中位數）
+	int has_counters;
+	int ok;
 } Sort_Result;
 
+int key_range = 100000;	// 隨機資料的鍵值範圍 [0, key_range)
+
+// 排序演算法登記表：新增演算法只要往 algos[] 加一列
+typedef struct {
+	const char *id;		// 命令列用的短名字
+	const char *name;
+	void (*func)(int[], const int);
+	const char *base_id;	// 平行版本對照的單執行緒演算法，其他是 NULL
+} Sort_Algo;
+
 // ============================================================
 // 輔助函數
 // ============================================================
 
-// 交換兩個整數
-void swap(int *a, int *b)
+// 交換兩個元素（int 以外的型別給泛型排序用）
+template <typename T>
+inline void swap(T *a, T *b)
 {
-	int t;
+	T t;
 	
 	t = *a;
 	*a = *b;
 	*b = t;
 }
 
+// 預設比較子：operator<。比較子當成模板參數傳，編譯器會整個 inline 進排序迴圈，
+// 不像 qsort 每次比較都要透過函數指標呼叫。
+struct Less_Than {
+	template <typename T>
+	bool operator()(const T &a, const T &b) const { return a < b; }
+};
+
 // 檢查陣列是否已排序
 int is_sorted(const int a[], const int n)
 {
@@ -60,7 +106,7 @@ void generate_random(int a[], const int n, const int seed)
 	
 	srandom(seed);
 	for (i = 0; i < n; i++)
-		a[i] = random() % 100000;
+		a[i] = random() % key_range;
 }
 
 // 生成已排序陣列
@@ -81,6 +127,139 @@ void generate_reversed(int a[], const int n)
 		a[i] = n - i;
 }
 
+// 以下幾種分布給 sweep 模式用，看各演算法在不同輸入形狀下的表現
+
+// 只有少數幾種值（大量重複）
+#define FEW_UNIQUE 16
+
+void generate_few_unique(int a[], const int n, const int seed)
+{
+	int i;
+	
+	srandom(seed);
+	for (i = 0; i < n; i++)
+		a[i] = random() % FEW_UNIQUE;
+}
+
+// 管風琴：先遞增再遞減
+void generate_organ_pipe(int a[], const int n)
+{
+	int i;
+	
+	for (i = 0; i < n; i++)
+		a[i] = i < n / 2 ? i : n - i;
+}
+
+// 幾乎排好：已排序陣列再隨機交換 k 對；k <= 0 時用 n 的 1%
+int near_swaps = 0;
+
+void generate_nearly_sorted(int a[], const int n, const int seed)
+{
+	int i, k;
+	
+	generate_sorted(a, n);
+	if (n < 2)
+		return;
+	k = near_swaps > 0 ? near_swaps : n / 100 + 1;
+	srandom(seed);
+	for (i = 0; i < k; i++)
+		swap(&a[random() % n], &a[random() % n]);
+}
+
+// Zipf（s = 1）：值 r 出現的機率正比於 1 / (r + 1)，r 在 [0, key_range)；先建累積分布再二分搜尋
+void generate_zipf(int a[], const int n, const int seed)
+{
+	double *cdf, sum, u;
+	int i, lo, hi, mid;
+	
+	cdf = (double *) malloc(sizeof(double) * key_range);
+	if (cdf == NULL) {
+		generate_random(a, n, seed);
+		return;
+	}
+	sum = 0;
+	for (i = 0; i < key_range; i++) {
+		sum += 1.0 / (i + 1);
+		cdf[i] = sum;
+	}
+	
+	srandom(seed);
+	for (i = 0; i < n; i++) {
+		u = (double) random() / 2147483648.0 * sum;
+		lo = 0;
+		hi = key_range - 1;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (cdf[mid] <= u)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		a[i] = lo;
+	}
+	free(cdf);
+}
+
+// 鋸齒：SAWTOOTH_TEETH 段遞增的斜坡
+#define SAWTOOTH_TEETH 16
+
+void generate_sawtooth(int a[], const int n)
+{
+	int i, period;
+	
+	period = n / SAWTOOTH_TEETH > 0 ? n / SAWTOOTH_TEETH : 1;
+	for (i = 0; i < n; i++)
+		a[i] = i % period;
+}
+
+// data_type 對照表
+enum {
+	DATA_RANDOM = 0, DATA_SORTED, DATA_REVERSED, DATA_FEW_UNIQUE,
+	DATA_ORGAN_PIPE, DATA_NEARLY_SORTED, DATA_ZIPF, DATA_SAWTOOTH,
+	NUM_DATA_TYPES
+};
+
+const char *DATA_NAMES[NUM_DATA_TYPES] = {
+	"隨機資料", "已排序資料", "反向排序資料", "少數幾種值",
+	"管風琴", "幾乎排好", "Zipf 分布", "鋸齒"
+};
+
+// CSV/JSON 裡用的英文名字
+const char *DATA_IDS[NUM_DATA_TYPES] = {
+	"random", "sorted", "reversed", "few_unique",
+	"organ_pipe", "nearly_sorted", "zipf", "sawtooth"
+};
+
+void generate_data(int a[], const int n, const int data_type, const int seed)
+{
+	switch (data_type) {
+	case DATA_RANDOM:
+		generate_random(a, n, seed);
+		break;
+	case DATA_SORTED:
+		generate_sorted(a, n);
+		break;
+	case DATA_FEW_UNIQUE:
+		generate_few_unique(a, n, seed);
+		break;
+	case DATA_ORGAN_PIPE:
+		generate_organ_pipe(a, n);
+		break;
+	case DATA_NEARLY_SORTED:
+		generate_nearly_sorted(a, n, seed);
+		break;
+	case DATA_ZIPF:
+		generate_zipf(a, n, seed);
+		break;
+	case DATA_SAWTOOTH:
+		generate_sawtooth(a, n);
+		break;
+	default:
+		generate_reversed(a, n);
+		break;
+	}
+}
+
 // 印出陣列（除錯用）
 void print_array(const int a[], const int n)
 {
@@ -99,15 +278,20 @@ void print_array(const int a[], const int n)
 // 排序演算法實作
 // ============================================================
 
+// 每種排序都是「元素型別 T + 比較子 Less」的模板，less(x, y) 代表 x 必須排在 y 前面；
+// 底下的 int 版本只是用 Less_Than 實例化，給登記表與測試框架用。
+
 // 1. 插入排序 (Insertion Sort)
-void insertion_sort(int a[], const int n)
+template <typename T, typename Less>
+void insertion_sort(T a[], const int n, Less less)
 {
-	int i, j, key;
+	int i, j;
+	T key;
 	
 	for (i = 1; i < n; i++) {
 		key = a[i];
 		j = i - 1;
-		while (j >= 0 && a[j] > key) {
+		while (j >= 0 && less(key, a[j])) {
 			a[j + 1] = a[j];
 			j--;
 		}
@@ -115,31 +299,280 @@ void insertion_sort(int a[], const int n)
 	}
 }
 
+void insertion_sort(int a[], const int n)
+{
+	insertion_sort(a, n, Less_Than());
+}
+
 // 2. 選擇排序 (Selection Sort)
-void selection_sort(int a[], const int n)
+template <typename T, typename Less>
+void selection_sort(T a[], const int n, Less less)
 {
 	int i, j, min;
 	
 	for (i = 0; i < n - 1; i++) {
 		min = i;
 		for (j = i + 1; j < n; j++)
-			if (a[j] < a[min])
+			if (less(a[j], a[min]))
 				min = j;
 		if (min != i)
 			swap(&a[i], &a[min]);
 	}
 }
 
+void selection_sort(int a[], const int n)
+{
+	selection_sort(a, n, Less_Than());
+}
+
+// ============================================================
+// 小區段排序核心：AVX2 雙調排序網路 (bitonic sorting network)
+// ============================================================
+// 8 個 int 剛好一個 __m256i；8/16/32/64 個分別用 1/2/4/8 個暫存器排，不足的補 INT_MAX。
+// 先把每個暫存器內部排好，再兩組兩組用雙調合併，全程沒有分支。
+// 沒有 AVX2 的 CPU（或非 x86）就退回插入排序。
+
+#if P2_X86_SIMD
+
+// 暫存器內的一次比較交換：partner 是重排過的自己，mask 為 1 的 lane 拿大的
+#define CMPX(v, partner, mask) \
+	_mm256_blend_epi32(_mm256_min_epi32((v), (partner)), _mm256_max_epi32((v), (partner)), (mask))
+
+__attribute__((target("avx2"), always_inline))
+static inline __m256i vec_reverse(const __m256i v)
+{
+	return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+// 雙調序列 → 遞增：距離 4、2、1 各比一次
+__attribute__((target("avx2"), always_inline))
+static inline __m256i vec_bitonic_merge(__m256i v)
+{
+	v = CMPX(v, _mm256_permute2x128_si256(v, v, 1), 0xF0);
+	v = CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)), 0xCC);
+	return CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), 0xAA);
+}
+
+// 一個暫存器內 8 個數排成遞增：兩兩 → 四個一組 → 八個
+__attribute__((target("avx2"), always_inline))
+static inline __m256i vec_sort8(__m256i v)
+{
+	v = CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), 0xAA);
+	v = CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)), 0xCC);
+	v = CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), 0xAA);
+	v = CMPX(v, vec_reverse(v), 0xF0);
+	v = CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)), 0xCC);
+	return CMPX(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), 0xAA);
+}
+
+// a[0..k) 與 b[0..k) 各自遞增（k 個暫存器），合併後 a 放小的 8k 個、b 放大的 8k 個
+__attribute__((target("avx2"), always_inline))
+static inline void vec_merge_groups(__m256i a[], __m256i b[], const int k)
+{
+	__m256i r, lo, hi;
+	int i, d, j;
+	
+	// a 對上反轉的 b：小的那一半與大的那一半各自是雙調序列
+	for (i = 0; i < k / 2; i++) {
+		r = vec_reverse(b[i]);
+		b[i] = vec_reverse(b[k - 1 - i]);
+		b[k - 1 - i] = r;
+	}
+	if (k & 1)
+		b[k / 2] = vec_reverse(b[k / 2]);
+	for (i = 0; i < k; i++) {
+		lo = _mm256_min_epi32(a[i], b[i]);
+		hi = _mm256_max_epi32(a[i], b[i]);
+		a[i] = lo;
+		b[i] = hi;
+	}
+	
+	// 跨暫存器的距離（8d）用整個暫存器比，暫存器內的交給 vec_bitonic_merge
+	for (d = k / 2; d > 0; d /= 2) {
+		for (i = 0; i < k; i++) {
+			if (i & d)
+				continue;
+			j = i + d;
+			lo = _mm256_min_epi32(a[i], a[j]);
+			a[j] = _mm256_max_epi32(a[i], a[j]);
+			a[i] = lo;
+			lo = _mm256_min_epi32(b[i], b[j]);
+			b[j] = _mm256_max_epi32(b[i], b[j]);
+			b[i] = lo;
+		}
+	}
+	for (i = 0; i < k; i++) {
+		a[i] = vec_bitonic_merge(a[i]);
+		b[i] = vec_bitonic_merge(b[i]);
+	}
+}
+
+// nv 個暫存器（1、2、4、8）整體排序；常數 nv 展開後全部留在暫存器裡
+__attribute__((target("avx2"), always_inline))
+static inline void vec_sort_regs(__m256i v[], const int nv)
+{
+	int i, w;
+	
+	for (i = 0; i < nv; i++)
+		v[i] = vec_sort8(v[i]);
+	for (w = 1; w < nv; w *= 2)
+		for (i = 0; i < nv; i += 2 * w)
+			vec_merge_groups(v + i, v + i + w, w);
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline void sort_block_avx2(int a[], const int n, const int nv)
+{
+	__m256i v[8];
+	int buf[64] __attribute__((aligned(32)));
+	int i;
+	
+	memcpy(buf, a, sizeof(int) * n);
+	for (i = n; i < 8 * nv; i++)
+		buf[i] = INT_MAX;
+	for (i = 0; i < nv; i++)
+		v[i] = _mm256_load_si256((const __m256i *)(buf + 8 * i));
+	vec_sort_regs(v, nv);
+	for (i = 0; i < nv; i++)
+		_mm256_store_si256((__m256i *)(buf + 8 * i), v[i]);
+	memcpy(a, buf, sizeof(int) * n);
+}
+
+__attribute__((target("avx2")))
+void sort_small_avx2(int a[], const int n)
+{
+	if (n <= 8)
+		sort_block_avx2(a, n, 1);
+	else if (n <= 16)
+		sort_block_avx2(a, n, 2);
+	else if (n <= 32)
+		sort_block_avx2(a, n, 4);
+	else
+		sort_block_avx2(a, n, 8);
+}
+
+// 兩段各取 8 個放進暫存器，雙調合併後寫出小的 8 個，大的 8 個留著跟下一塊合併；
+// 下一塊從開頭比較小的那段拿。剩不到 8 個時，把手上的 8 個跟兩段的尾巴用純量三路合併收尾。
+__attribute__((target("avx2")))
+void merge_two_avx2(const int A[], const int na, const int B[], const int nb, int dst[])
+{
+	__m256i lo, hi;
+	int tmp[8] __attribute__((aligned(32)));
+	int i, j, k, t, x;
+	
+	lo = _mm256_loadu_si256((const __m256i *) A);
+	hi = _mm256_loadu_si256((const __m256i *) B);
+	i = 8;
+	j = 8;
+	k = 0;
+	for (;;) {
+		vec_merge_groups(&lo, &hi, 1);
+		_mm256_storeu_si256((__m256i *)(dst + k), lo);
+		k += 8;
+		if (i + 8 <= na && (j >= nb || A[i] <= B[j])) {
+			lo = _mm256_loadu_si256((const __m256i *)(A + i));
+			i += 8;
+		} else if (j + 8 <= nb && (i >= na || B[j] < A[i])) {
+			lo = _mm256_loadu_si256((const __m256i *)(B + j));
+			j += 8;
+		} else
+			break;
+	}
+	
+	_mm256_store_si256((__m256i *) tmp, hi);
+	t = 0;
+	while (t < 8 || i < na || j < nb) {
+		x = 0;	// 0: tmp、1: A、2: B
+		if (t >= 8 || (i < na && A[i] < tmp[t]))
+			x = 1;
+		if (j < nb && (x == 0 ? (t >= 8 || B[j] < tmp[t]) : (i >= na || B[j] < A[i])))
+			x = 2;
+		if (x == 0)
+			dst[k++] = tmp[t++];
+		else if (x == 1)
+			dst[k++] = A[i++];
+		else
+			dst[k++] = B[j++];
+	}
+}
+
+#undef CMPX
+
+#endif
+
+int has_avx2(void)
+{
+	static int avx2 = -1;
+	
+	if (avx2 < 0) {
+		avx2 = 0;
+#if P2_X86_SIMD
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	}
+	return avx2;
+}
+
+// 葉節點的大小上限：有 AVX2 時排序網路一次吃 64 個，純量插入排序超過 16 個就不划算
+#define SMALL_SORT_MAX 64
+#define SMALL_SORT_SCALAR 16
+
+int small_sort_max(void)
+{
+	return has_avx2() ? SMALL_SORT_MAX : SMALL_SORT_SCALAR;
+}
+
+// n <= SMALL_SORT_MAX 的小區段排序，各種遞迴排序的葉節點都走這裡
+void sort_small(int a[], const int n)
+{
+	if (n < 2)
+		return;
+#if P2_X86_SIMD
+	if (has_avx2()) {
+		sort_small_avx2(a, n);
+		return;
+	}
+#endif
+	insertion_sort(a, n);
+}
+
+// 泛型排序的葉節點：一般型別用插入排序；int 配預設比較子時是完全相符的多載，
+// 編譯期就會選到下面的版本，改走 sort_small（排序網路）。
+template <typename T, typename Less>
+inline int leaf_max(const T *, Less)
+{
+	return SMALL_SORT_SCALAR;
+}
+
+template <typename T, typename Less>
+inline void leaf_sort(T a[], const int n, Less less)
+{
+	insertion_sort(a, n, less);
+}
+
+inline int leaf_max(const int *, Less_Than)
+{
+	return small_sort_max();
+}
+
+inline void leaf_sort(int a[], const int n, Less_Than)
+{
+	sort_small(a, n);
+}
+
 // 3. 快速排序 (Quick Sort)
-int partition(int a[], const int low, const int high)
+template <typename T, typename Less>
+int partition(T a[], const int low, const int high, Less less)
 {
-	int pivot, i, j;
+	int i, j;
+	T pivot;
 	
 	pivot = a[high];
 	i = low - 1;
 	
 	for (j = low; j < high; j++) {
-		if (a[j] <= pivot) {
+		if (!less(pivot, a[j])) {
 			i++;
 			swap(&a[i], &a[j]);
 		}
@@ -148,34 +581,49 @@ int partition(int a[], const int low, const int high)
 	return i + 1;
 }
 
-void quick_sort_recursive(int a[], const int low, const int high)
+template <typename T, typename Less>
+void quick_sort_recursive(T a[], const int low, const int high, Less less)
 {
 	int pi;
 	
+	// 小區段交給排序網路
+	if (high - low + 1 <= leaf_max(a, less)) {
+		leaf_sort(a + low, high - low + 1, less);
+		return;
+	}
 	if (low < high) {
-		pi = partition(a, low, high);
-		quick_sort_recursive(a, low, pi - 1);
-		quick_sort_recursive(a, pi + 1, high);
+		pi = partition(a, low, high, less);
+		quick_sort_recursive(a, low, pi - 1, less);
+		quick_sort_recursive(a, pi + 1, high, less);
 	}
 }
 
+template <typename T, typename Less>
+void quick_sort(T a[], const int n, Less less)
+{
+	quick_sort_recursive(a, 0, n - 1, less);
+}
+
 void quick_sort(int a[], const int n)
 {
-	quick_sort_recursive(a, 0, n - 1);
+	quick_sort(a, n, Less_Than());
 }
 
 // 4. 合併排序 (Merge Sort)
-void merge(int a[], const int l, const int m, const int r)
+// 暫存區用 malloc 配置、直接賦值搬移，所以元素必須是 trivially copyable（紀錄、鍵值對都沒問題）
+template <typename T, typename Less>
+void merge(T a[], const int l, const int m, const int r, Less less)
 {
 	int i, j, k;
 	int n1, n2;
-	int *L, *R;
+	T *L, *R;
 	
+	static_assert(std::is_trivially_copyable<T>::value, "merge() 只支援 trivially copyable 的元素");
 	n1 = m - l + 1;
 	n2 = r - m;
 	
-	L = (int *) malloc(sizeof(int) * n1);
-	R = (int *) malloc(sizeof(int) * n2);
+	L = (T *) malloc(sizeof(T) * n1);
+	R = (T *) malloc(sizeof(T) * n2);
 	
 	for (i = 0; i < n1; i++)
 		L[i] = a[l + i];
@@ -186,8 +634,9 @@ void merge(int a[], const int l, const int m, const int r)
 	j = 0;
 	k = l;
 	
+	// 相等時取左邊，維持穩定
 	while (i < n1 && j < n2) {
-		if (L[i] <= R[j]) {
+		if (!less(R[j], L[i])) {
 			a[k] = L[i];
 			i++;
 		} else {
@@ -213,25 +662,37 @@ void merge(int a[], const int l, const int m, const int r)
 	free(R);
 }
 
-void merge_sort_recursive(int a[], const int l, const int r)
+template <typename T, typename Less>
+void merge_sort_recursive(T a[], const int l, const int r, Less less)
 {
 	int m;
 	
+	if (r - l + 1 <= leaf_max(a, less)) {
+		leaf_sort(a + l, r - l + 1, less);
+		return;
+	}
 	if (l < r) {
 		m = l + (r - l) / 2;
-		merge_sort_recursive(a, l, m);
-		merge_sort_recursive(a, m + 1, r);
-		merge(a, l, m, r);
+		merge_sort_recursive(a, l, m, less);
+		merge_sort_recursive(a, m + 1, r, less);
+		merge(a, l, m, r, less);
 	}
 }
 
+template <typename T, typename Less>
+void merge_sort(T a[], const int n, Less less)
+{
+	merge_sort_recursive(a, 0, n - 1, less);
+}
+
 void merge_sort(int a[], const int n)
 {
-	merge_sort_recursive(a, 0, n - 1);
+	merge_sort(a, n, Less_Than());
 }
 
 // 5. 堆積排序 (Heap Sort)
-void heapify(int a[], const int n, const int i)
+template <typename T, typename Less>
+void heapify(T a[], const int n, const int i, Less less)
 {
 	int largest, left, right;
 	
@@ -239,174 +700,2637 @@ void heapify(int a[], const int n, const int i)
 	left = 2 * i + 1;
 	right = 2 * i + 2;
 	
-	if (left < n && a[left] > a[largest])
+	if (left < n && less(a[largest], a[left]))
 		largest = left;
 	
-	if (right < n && a[right] > a[largest])
+	if (right < n && less(a[largest], a[right]))
 		largest = right;
 	
 	if (largest != i) {
 		swap(&a[i], &a[largest]);
-		heapify(a, n, largest);
+		heapify(a, n, largest, less);
 	}
 }
 
-void heap_sort(int a[], const int n)
+template <typename T, typename Less>
+void heap_sort(T a[], const int n, Less less)
 {
 	int i;
 	
 	for (i = n / 2 - 1; i >= 0; i--)
-		heapify(a, n, i);
+		heapify(a, n, i, less);
 	
 	for (i = n - 1; i > 0; i--) {
 		swap(&a[0], &a[i]);
-		heapify(a, i, 0);
+		heapify(a, i, 0, less);
 	}
 }
 
-// ============================================================
-// 效能測試函數
-// ============================================================
+void heap_sort(int a[], const int n)
+{
+	heap_sort(a, n, Less_Than());
+}
 
-double test_sort(void (*sort_func)(int[], const int), 
-                 int a[], const int n, const char *name)
+// 6. 內省排序 (Introsort)
+// 快速排序的改良：三數取中（大區段用 ninther）選 pivot、三路切分應付大量重複值、
+// 小區段交給 sort_small（排序網路或插入排序），遞迴太深（超過 2 log n）就改用堆積排序，最差情況仍是 O(n log n)。
+// 回傳 a[i]、a[j]、a[k] 中位數的索引
+template <typename T, typename Less>
+int median3(const T a[], const int i, const int j, const int k, Less less)
 {
-	clock_t start, end;
-	double cpu_time;
-	
-	printf("測試 %s...", name);
-	fflush(stdout);
+	if (less(a[i], a[j])) {
+		if (less(a[j], a[k]))
+			return j;
+		return less(a[i], a[k]) ? k : i;
+	}
+	if (less(a[i], a[k]))
+		return i;
+	return less(a[j], a[k]) ? k : j;
+}
+
+// 大區段用 Tukey's ninther：三組各取中位數，再取中位數
+template <typename T, typename Less>
+int choose_pivot(const T a[], const int low, const int high, Less less)
+{
+	int n, mid, s;
 	
-	start = clock();
-	sort_func(a, n);
-	end = clock();
+	n = high - low + 1;
+	mid = low + n / 2;
+	if (n < 128)
+		return median3(a, low, mid, high, less);
 	
-	cpu_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+	s = n / 8;
+	return median3(a, median3(a, low, low + s, low + 2 * s, less),
+	               median3(a, mid - s, mid, mid + s, less),
+	               median3(a, high - 2 * s, high - s, high, less), less);
+}
+
+template <typename T, typename Less>
+void intro_sort_loop(T a[], int low, int high, int depth, Less less)
+{
+	int lt, gt, i;
+	T pivot;
 	
-	if (is_sorted(a, n))
-		printf(" 正確");
-	else
-		printf(" 錯誤！");
+	while (high - low + 1 > leaf_max(a, less)) {
+		if (depth == 0) {
+			heap_sort(a + low, high - low + 1, less);
+			return;
+		}
+		depth--;
+		
+		// 三路切分 (Dijkstra)：[low, lt) < pivot、[lt, gt] == pivot、(gt, high] > pivot
+		pivot = a[choose_pivot(a, low, high, less)];
+		lt = low;
+		gt = high;
+		i = low;
+		while (i <= gt) {
+			if (less(a[i], pivot))
+				swap(&a[lt++], &a[i++]);
+			else if (less(pivot, a[i]))
+				swap(&a[i], &a[gt--]);
+			else
+				i++;
+		}
+		
+		// 遞迴處理比較小的一邊，大的一邊留在迴圈裡，堆疊深度最多 O(log n)
+		if (lt - low < high - gt) {
+			intro_sort_loop(a, low, lt - 1, depth, less);
+			low = gt + 1;
+		} else {
+			intro_sort_loop(a, gt + 1, high, depth, less);
+			high = lt - 1;
+		}
+	}
 	
-	printf(" (%.4f 秒)\n", cpu_time);
+	if (high > low)
+		leaf_sort(a + low, high - low + 1, less);
+}
+
+template <typename T, typename Less>
+void intro_sort(T a[], const int n, Less less)
+{
+	int depth, m;
 	
-	return cpu_time;
+	depth = 0;
+	for (m = n; m > 1; m >>= 1)
+		depth += 2;
+	intro_sort_loop(a, 0, n - 1, depth, less);
 }
 
-// ============================================================
-// 主程式
-// ============================================================
+void intro_sort(int a[], const int n)
+{
+	intro_sort(a, n, Less_Than());
+}
 
-int main(int ac, char *av[])
+// 7. 自底向上合併排序 (Bottom-up Merge Sort)
+// 只配置一次暫存陣列，兩個陣列輪流當來源與目的地，不必每次合併都 malloc。
+// 先切出天然的遞增段（遞減段就地反轉），太短的用 sort_small 補到 MERGE_CUTOFF；
+// 相鄰兩段已經有序（左段最後 <= 右段開頭）就直接搬過去，不做比較。
+#define MERGE_CUTOFF 32
+
+// 把 A[0, na) 與 B[0, nb) 合併到 dst；相等時先取 A，保持穩定
+void merge_two_scalar(const int A[], const int na, const int B[], const int nb, int dst[])
 {
-	int *original, *temp;
-	int n, seed, debug, data_type;
-	Sort_Result results[5];
-	int i;
+	int i, j, k, take_right;
 	
-	// 預設參數
-	n = 10000;
-	seed = 12345;
-	debug = 0;
-	data_type = 0;  // 0: 隨機, 1: 已排序, 2: 反向
+	i = 0;
+	j = 0;
+	k = 0;
+	// 無分支寫法：隨機資料下哪邊比較小猜不準，改用條件搬移
+	while (i < na && j < nb) {
+		take_right = B[j] < A[i];
+		dst[k++] = take_right ? B[j] : A[i];
+		j += take_right;
+		i += !take_right;
+	}
+	memcpy(dst + k, A + i, sizeof(int) * (na - i));
+	k += na - i;
+	memcpy(dst + k, B + j, sizeof(int) * (nb - j));
+}
+
+// 兩段都至少 8 個而且有 AVX2 就走向量版本（int 相等時誰先誰後看不出來，不影響結果）
+void merge_two(const int A[], const int na, const int B[], const int nb, int dst[])
+{
+#if P2_X86_SIMD
+	if (na >= 8 && nb >= 8 && has_avx2()) {
+		merge_two_avx2(A, na, B, nb, dst);
+		return;
+	}
+#endif
+	merge_two_scalar(A, na, B, nb, dst);
+}
+
+// 把 src[lo, mid) 與 src[mid, hi) 合併到 dst[lo, hi)
+void merge_into(const int src[], int dst[], const int lo, const int mid, const int hi)
+{
+	merge_two(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+}
+
+void reverse_array(int a[], int lo, int hi)
+{
+	while (lo < hi)
+		swap(&a[lo++], &a[hi--]);
+}
+
+void merge_sort_bu(int a[], const int n)
+{
+	int *buf, *bounds, *src, *dst, *t;
+	int runs, lo, mid, hi, k;
 	
-	// 讀取命令列參數
-	if (ac > 1)
-		sscanf(av[1], "%d", &n);
-	if (ac > 2)
-		sscanf(av[2], "%d", &seed);
-	if (ac > 3)
-		sscanf(av[3], "%d", &debug);
-	if (ac > 4)
-		sscanf(av[4], "%d", &data_type);
-	
-	printf("=================================================\n");
-	printf("排序演算法效能比較\n");
-	printf("=================================================\n");
-	printf("資料量: n = %d\n", n);
-	printf("隨機種子: %d\n", seed);
-	printf("資料類型: ");
-	
-	if (data_type == 0)
-		printf("隨機資料\n");
-	else if (data_type == 1)
-		printf("已排序資料\n");
-	else
-		printf("反向排序資料\n");
+	if (n < 2)
+		return;
 	
-	printf("除錯模式: %s\n", debug ? "開啟" : "關閉");
-	printf("=================================================\n\n");
+	buf = (int *) malloc(sizeof(int) * n);
+	bounds = (int *) malloc(sizeof(int) * (n / MERGE_CUTOFF + 2));
+	if (buf == NULL || bounds == NULL) {
+		free(buf);
+		free(bounds);
+		merge_sort(a, n);
+		return;
+	}
 	
-	// 配置記憶體
-	original = (int *) malloc(sizeof(int) * n);
-	temp = (int *) malloc(sizeof(int) * n);
+	// 第一趟：切出天然的段，bounds[k] 是第 k 段的起點；除了最後一段，每段至少 MERGE_CUTOFF 個
+	runs = 0;
+	lo = 0;
+	while (lo < n) {
+		hi = lo + 1;
+		if (hi < n && a[hi] < a[lo]) {
+			while (hi < n && a[hi] < a[hi - 1])
+				hi++;
+			reverse_array(a, lo, hi - 1);
+		} else {
+			while (hi < n && a[hi] >= a[hi - 1])
+				hi++;
+		}
+		if (hi - lo < MERGE_CUTOFF) {
+			hi = lo + MERGE_CUTOFF < n ? lo + MERGE_CUTOFF : n;
+			sort_small(a + lo, hi - lo);
+		}
+		bounds[runs++] = lo;
+		lo = hi;
+	}
+	bounds[runs] = n;
 	
-	if (original == NULL || temp == NULL) {
-		printf("記憶體配置失敗！\n");
-		return 1;
+	// 之後每一趟把相鄰兩段合併成一段，段數減半
+	src = a;
+	dst = buf;
+	while (runs > 1) {
+		for (k = 0; k + 1 < runs; k += 2) {
+			lo = bounds[k];
+			mid = bounds[k + 1];
+			hi = bounds[k + 2];
+			if (src[mid - 1] <= src[mid])
+				memcpy(dst + lo, src + lo, sizeof(int) * (hi - lo));
+			else
+				merge_into(src, dst, lo, mid, hi);
+			bounds[k / 2] = lo;
+		}
+		if (k < runs) {
+			memcpy(dst + bounds[k], src + bounds[k], sizeof(int) * (n - bounds[k]));
+			bounds[k / 2] = bounds[k];
+		}
+		runs = (runs + 1) / 2;
+		bounds[runs] = n;
+		t = src;
+		src = dst;
+		dst = t;
 	}
 	
-	// 生成測試資料
-	if (data_type == 0)
-		generate_random(original, n, seed);
-	else if (data_type == 1)
-		generate_sorted(original, n);
-	else
-		generate_reversed(original, n);
+	if (src != a)
+		memcpy(a, src, sizeof(int) * n);
+	free(buf);
+	free(bounds);
+}
+
+// 10. LSD 基數排序 (LSD Radix Sort)
+// 每次看 8 位元、從低位做到高位，共四趟；有號整數翻轉符號位元當成無號數排。
+// 四趟的直方圖在一開始讀一遍就全部算好，之後每趟只需要搬資料；
+// 某一趟所有元素的那個位數都一樣就整趟跳過（鍵值 < 100000 時最高位元組全是 0）。
+static inline unsigned int radix_key(const int x)
+{
+	return (unsigned int)x ^ 0x80000000u;
+}
+
+void radix_sort_lsd(int a[], const int n)
+{
+	static unsigned int count[4][256];	// 1 KiB × 4，放靜態區免得吃堆疊
+	unsigned int key, sum, c;
+	int *buf, *src, *dst, *t;
+	int i, pass, shift, b;
 	
-	// 除錯模式：印出部分資料
-	if (debug && n <= 100) {
-		printf("原始資料：\n");
-		print_array(original, n);
-		putchar('\n');
+	if (n < 2)
+		return;
+	buf = (int *) malloc(sizeof(int) * n);
+	if (buf == NULL) {
+		intro_sort(a, n);
+		return;
 	}
 	
-	// 測試各個排序演算法
-	// 1. 插入排序
-	copy_array(temp, original, n);
-	results[0].time = test_sort(insertion_sort, temp, n, "插入排序");
-	strcpy(results[0].name, "插入排序");
-	if (debug && n <= 100) {
-		printf("排序後：\n");
-		print_array(temp, n);
-		putchar('\n');
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++) {
+		key = radix_key(a[i]);
+		count[0][key & 255]++;
+		count[1][(key >> 8) & 255]++;
+		count[2][(key >> 16) & 255]++;
+		count[3][key >> 24]++;
 	}
 	
-	// 2. 選擇排序
-	copy_array(temp, original, n);
-	results[1].time = test_sort(selection_sort, temp, n, "選擇排序");
-	strcpy(results[1].name, "選擇排序");
+	src = a;
+	dst = buf;
+	for (pass = 0; pass < 4; pass++) {
+		shift = pass * 8;
+		if (count[pass][(radix_key(src[0]) >> shift) & 255] == (unsigned int)n)
+			continue;
+		
+		// 直方圖轉成每個桶的寫入位置
+		sum = 0;
+		for (b = 0; b < 256; b++) {
+			c = count[pass][b];
+			count[pass][b] = sum;
+			sum += c;
+		}
+		for (i = 0; i < n; i++) {
+			key = (radix_key(src[i]) >> shift) & 255;
+			dst[count[pass][key]++] = src[i];
+		}
+		t = src;
+		src = dst;
+		dst = t;
+	}
 	
-	// 3. 快速排序
-	copy_array(temp, original, n);
-	results[2].time = test_sort(quick_sort, temp, n, "快速排序");
-	strcpy(results[2].name, "快速排序");
+	if (src != a)
+		memcpy(a, src, sizeof(int) * n);
+	free(buf);
+}
+
+// 11. MSD 基數排序 (American Flag Sort)
+// 就地版本：從最高位元組開始，數完每桶大小後用循環交換把元素直接放進自己的桶，
+// 不需要第二個陣列；再對每一桶遞迴下一個位元組，小桶交給 sort_small。
+#define FLAG_CUTOFF 32
+
+void american_flag_pass(int a[], const int n, const int shift)
+{
+	int count[256], next[256], end[256];
+	int i, b, d, x, t, sum;
 	
-	// 4. 合併排序
-	copy_array(temp, original, n);
-	results[3].time = test_sort(merge_sort, temp, n, "合併排序");
-	strcpy(results[3].name, "合併排序");
+	if (n <= FLAG_CUTOFF) {
+		sort_small(a, n);
+		return;
+	}
 	
-	// 5. 堆積排序
-	copy_array(temp, original, n);
-	results[4].time = test_sort(heap_sort, temp, n, "堆積排序");
-	strcpy(results[4].name, "堆積排序");
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++)
+		count[(radix_key(a[i]) >> shift) & 255]++;
 	
-	// 印出結果摘要
-	printf("\n=================================================\n");
-	printf("效能摘要 (n = %d)\n", n);
-	printf("=================================================\n");
-	printf("%-15s %15s\n", "演算法", "執行時間(秒)");
-	printf("-------------------------------------------------\n");
+	// 全部落在同一桶：這個位元組不用排，直接看下一個
+	if (count[(radix_key(a[0]) >> shift) & 255] == n) {
+		if (shift > 0)
+			american_flag_pass(a, n, shift - 8);
+		return;
+	}
 	
-	for (i = 0; i < 5; i++)
-		printf("%-15s %15.4f\n", results[i].name, results[i].time);
+	sum = 0;
+	for (b = 0; b < 256; b++) {
+		next[b] = sum;
+		sum += count[b];
+		end[b] = sum;
+	}
 	
-	printf("=================================================\n");
+	// 循環交換：手上的元素不屬於桶 b 就丟到它該去的桶，換回那裡的元素繼續
+	for (b = 0; b < 256; b++) {
+		while (next[b] < end[b]) {
+			x = a[next[b]];
+			d = (radix_key(x) >> shift) & 255;
+			while (d != b) {
+				t = a[next[d]];
+				a[next[d]++] = x;
+				x = t;
+				d = (radix_key(x) >> shift) & 255;
+			}
+			a[next[b]++] = x;
+		}
+	}
 	
-	// 釋放記憶體
-	free(original);
-	free(temp);
+	if (shift == 0)
+		return;
+	for (b = 0, sum = 0; b < 256; sum += count[b], b++)
+		if (count[b] > 1)
+			american_flag_pass(a + sum, count[b], shift - 8);
+}
+
+void american_flag_sort(int a[], const int n)
+{
+	if (n > 1)
+		american_flag_pass(a, n, 24);
+}
+
+// 12. 自底向上堆積排序 (Bottom-up Heapsort)
+// 一般的 heapify 每層比兩次（兩個孩子比、再跟要放的元素比）。這裡先不管要放的元素 x，
+// 把洞沿著較大的孩子一路推到葉子（每層只比一次、較大的孩子往上補），再讓 x 從葉子往上浮。
+// 排序時 x 是從堆尾換上來的小元素，幾乎都停在葉子附近，往上只要比一兩次，
+// 總比較次數從約 2n log n 降到約 n log n，而且往下那段沒有難猜的分支。
+// 全部是迴圈不遞迴；建堆用 Floyd 的方法，從最後一個內部節點往前篩，O(n)。
+// x 原本在子樹的根 top，往上浮最多回到 top。
+static inline void sift_hole(int a[], const int n, const int top, const int x)
+{
+	int i, c, p;
 	
-	return 0;
-}
\ No newline at end of file
+	i = top;
+	while ((c = 2 * i + 2) < n) {
+		c -= a[c - 1] > a[c];	// 左邊比較大就選左邊
+		a[i] = a[c];
+		i = c;
+	}
+	if (c == n) {			// 只剩一個左孩子
+		a[i] = a[n - 1];
+		i = n - 1;
+	}
+	
+	while (i > top && a[p = (i - 1) / 2] < x) {
+		a[i] = a[p];
+		i = p;
+	}
+	a[i] = x;
+}
+
+void heap_sort_bu(int a[], const int n)
+{
+	int i, x;
+	
+	for (i = n / 2 - 1; i >= 0; i--)
+		sift_hole(a, n, i, a[i]);
+	for (i = n - 1; i > 0; i--) {
+		x = a[i];
+		a[i] = a[0];
+		sift_hole(a, i, 0, x);
+	}
+}
+
+// 13. 四元堆積排序 (4-ary Heap Sort)
+// 每個節點四個孩子 (4i+1..4i+4)，樹高減半，n 大的時候往下走的快取失誤也少一半。
+// 堆放在 64 bytes 對齊的暫存區，而且往後挪 HEAP4_PAD 格：孩子落在暫存區的 4i+4..4i+7，
+// 四個 int 剛好 16 bytes、永遠在同一條快取線裡，挑最大的孩子只碰一條線。
+// 篩的方式跟 heap_sort_bu 一樣先推洞到葉子再往上浮；建堆也是 Floyd 的方法。
+// 暫存區配置失敗就改用 heap_sort_bu。
+#define HEAP4_PAD 3
+
+static inline void sift_hole4(int h[], const int n, const int top, const int x)
+{
+	int i, c, m, m2, p;
+	
+	i = top;
+	while ((c = 4 * i + 1) + 3 < n) {
+		// 四個孩子兩兩比，再比一次；沒有分支
+		m = c + (h[c + 1] > h[c]);
+		m2 = c + 2 + (h[c + 3] > h[c + 2]);
+		m = h[m2] > h[m] ? m2 : m;
+		h[i] = h[m];
+		i = m;
+	}
+	if (c < n) {			// 最後一組孩子不滿四個
+		for (m = c, c++; c < n; c++)
+			if (h[c] > h[m])
+				m = c;
+		h[i] = h[m];
+		i = m;
+	}
+	
+	while (i > top && h[p = (i - 1) / 4] < x) {
+		h[i] = h[p];
+		i = p;
+	}
+	h[i] = x;
+}
+
+void heap4_sort(int a[], const int n)
+{
+	int *buf, *h;
+	int i, x;
+	size_t bytes;
+	
+	if (n < 2)
+		return;
+	bytes = ((size_t) n + HEAP4_PAD) * sizeof(int);
+	bytes = (bytes + 63) / 64 * 64;
+	buf = (int *) aligned_alloc(64, bytes);
+	if (buf == NULL) {
+		heap_sort_bu(a, n);
+		return;
+	}
+	h = buf + HEAP4_PAD;
+	memcpy(h, a, sizeof(int) * n);
+	
+	for (i = (n - 2) / 4; i >= 0; i--)
+		sift_hole4(h, n, i, h[i]);
+	for (i = n - 1; i > 0; i--) {
+		x = h[i];
+		h[i] = h[0];
+		sift_hole4(h, i, 0, x);
+	}
+	
+	memcpy(a, h, sizeof(int) * n);
+	free(buf);
+}
+
+// ============================================================
+// 平行排序：固定大小的執行緒池，工作切成很多小塊讓執行緒自己來領
+// ============================================================
+
+typedef struct {
+	pthread_t *tid;
+	int nthreads;		// 含呼叫端自己，背景執行緒有 nthreads - 1 個
+	pthread_mutex_t mu;
+	pthread_cond_t wake, idle;
+	void (*fn)(void *ctx, const int task);
+	void *ctx;
+	int ntasks, next, running;
+	int generation, quit;
+} Thread_Pool;
+
+Thread_Pool g_pool;	// main 依命令列的執行緒數建立；nthreads == 0 代表還沒建立
+
+// 呼叫時要持有 mu；一次領一個工作，執行時放開鎖
+void pool_drain(Thread_Pool *p)
+{
+	int t;
+	
+	while (p->next < p->ntasks) {
+		t = p->next++;
+		p->running++;
+		pthread_mutex_unlock(&p->mu);
+		p->fn(p->ctx, t);
+		pthread_mutex_lock(&p->mu);
+		p->running--;
+	}
+	if (p->running == 0)
+		pthread_cond_broadcast(&p->idle);
+}
+
+void *pool_worker(void *arg)
+{
+	Thread_Pool *p = (Thread_Pool *) arg;
+	int gen = 0;
+	
+	pthread_mutex_lock(&p->mu);
+	for (;;) {
+		while (!p->quit && p->generation == gen)
+			pthread_cond_wait(&p->wake, &p->mu);
+		if (p->quit)
+			break;
+		gen = p->generation;
+		pool_drain(p);
+	}
+	pthread_mutex_unlock(&p->mu);
+	return NULL;
+}
+
+int pool_init(Thread_Pool *p, const int nthreads)
+{
+	int i;
+	
+	memset(p, 0, sizeof(*p));
+	p->nthreads = nthreads < 1 ? 1 : nthreads;
+	p->tid = (pthread_t *) malloc(sizeof(pthread_t) * p->nthreads);
+	if (p->tid == NULL)
+		return -1;
+	pthread_mutex_init(&p->mu, NULL);
+	pthread_cond_init(&p->wake, NULL);
+	pthread_cond_init(&p->idle, NULL);
+	for (i = 1; i < p->nthreads; i++) {
+		if (pthread_create(&p->tid[i], NULL, pool_worker, p) != 0) {
+			p->nthreads = i;	// 開不出來就用現有的
+			break;
+		}
+	}
+	return 0;
+}
+
+void pool_destroy(Thread_Pool *p)
+{
+	int i;
+	
+	pthread_mutex_lock(&p->mu);
+	p->quit = 1;
+	pthread_cond_broadcast(&p->wake);
+	pthread_mutex_unlock(&p->mu);
+	for (i = 1; i < p->nthreads; i++)
+		pthread_join(p->tid[i], NULL);
+	pthread_mutex_destroy(&p->mu);
+	pthread_cond_destroy(&p->wake);
+	pthread_cond_destroy(&p->idle);
+	free(p->tid);
+	memset(p, 0, sizeof(*p));
+}
+
+// 執行 fn(ctx, 0..ntasks-1)，呼叫端也一起做，全部做完才回來
+void pool_run(Thread_Pool *p, const int ntasks, void (*fn)(void *, const int), void *ctx)
+{
+	pthread_mutex_lock(&p->mu);
+	p->fn = fn;
+	p->ctx = ctx;
+	p->ntasks = ntasks;
+	p->next = 0;
+	p->generation++;
+	pthread_cond_broadcast(&p->wake);
+	pool_drain(p);
+	while (p->next < p->ntasks || p->running > 0)
+		pthread_cond_wait(&p->idle, &p->mu);
+	pthread_mutex_unlock(&p->mu);
+}
+
+int pool_threads(void)
+{
+	return g_pool.nthreads > 0 ? g_pool.nthreads : 1;
+}
+
+// 8. 平行合併排序 (Parallel Merge Sort)
+// 先切成 4T 段各自用 merge_sort_bu 排好，再兩兩合併；每一對的合併也切成好幾片，
+// 用 co-rank 二分搜尋找出每一片在左右兩段的起點，各片互不相干，可以同時做。
+#define PAR_MIN_N 65536		// 太小的陣列開執行緒不划算，直接用單執行緒版
+
+// 合併後的前 k 個元素裡有幾個來自 A（相等時 A 優先，跟 merge_two 一致）
+int co_rank(const int k, const int A[], const int na, const int B[], const int nb)
+{
+	int lo, hi, i;
+	
+	lo = k - nb > 0 ? k - nb : 0;
+	hi = k < na ? k : na;
+	while (lo < hi) {
+		i = lo + (hi - lo) / 2;
+		if (A[i] <= B[k - i - 1])
+			lo = i + 1;
+		else
+			hi = i;
+	}
+	return lo;
+}
+
+typedef struct {
+	int *src, *dst;
+	int *bounds;		// 目前各段的起點，bounds[runs] = n
+	int runs;
+	int pieces;		// 每一對切成幾片
+} Par_Merge;
+
+void par_sort_chunk(void *ctx, const int t)
+{
+	Par_Merge *m = (Par_Merge *) ctx;
+	
+	merge_sort_bu(m->src + m->bounds[t], m->bounds[t + 1] - m->bounds[t]);
+}
+
+void par_merge_piece(void *ctx, const int t)
+{
+	Par_Merge *m = (Par_Merge *) ctx;
+	int pair, piece, lo, mid, hi, total, k0, k1, i0, i1;
+	
+	pair = t / m->pieces;
+	piece = t % m->pieces;
+	lo = m->bounds[2 * pair];
+	
+	// 段數是奇數時，最後一段沒有對象，照搬
+	if (2 * pair + 1 >= m->runs) {
+		hi = m->bounds[m->runs];
+		k0 = lo + (int)((long long)(hi - lo) * piece / m->pieces);
+		k1 = lo + (int)((long long)(hi - lo) * (piece + 1) / m->pieces);
+		memcpy(m->dst + k0, m->src + k0, sizeof(int) * (k1 - k0));
+		return;
+	}
+	
+	mid = m->bounds[2 * pair + 1];
+	hi = m->bounds[2 * pair + 2];
+	total = hi - lo;
+	k0 = (int)((long long)total * piece / m->pieces);
+	k1 = (int)((long long)total * (piece + 1) / m->pieces);
+	i0 = co_rank(k0, m->src + lo, mid - lo, m->src + mid, hi - mid);
+	i1 = co_rank(k1, m->src + lo, mid - lo, m->src + mid, hi - mid);
+	merge_two(m->src + lo + i0, i1 - i0, m->src + mid + k0 - i0, (k1 - i1) - (k0 - i0), m->dst + lo + k0);
+}
+
+void par_merge_sort(int a[], const int n)
+{
+	Par_Merge m;
+	int *buf, *t;
+	int T, chunks, i, pairs;
+	
+	T = pool_threads();
+	if (T == 1 || n < PAR_MIN_N) {
+		merge_sort_bu(a, n);
+		return;
+	}
+	
+	chunks = 4 * T;
+	buf = (int *) malloc(sizeof(int) * n);
+	m.bounds = (int *) malloc(sizeof(int) * (chunks + 1));
+	if (buf == NULL || m.bounds == NULL) {
+		free(buf);
+		free(m.bounds);
+		merge_sort_bu(a, n);
+		return;
+	}
+	for (i = 0; i <= chunks; i++)
+		m.bounds[i] = (int)((long long)n * i / chunks);
+	
+	m.src = a;
+	m.dst = buf;
+	m.runs = chunks;
+	pool_run(&g_pool, chunks, par_sort_chunk, &m);
+	
+	while (m.runs > 1) {
+		pairs = (m.runs + 1) / 2;
+		m.pieces = (4 * T + pairs - 1) / pairs;
+		pool_run(&g_pool, pairs * m.pieces, par_merge_piece, &m);
+		
+		for (i = 0; 2 * i < m.runs; i++)
+			m.bounds[i] = m.bounds[2 * i];
+		m.runs = pairs;
+		m.bounds[m.runs] = n;
+		t = m.src;
+		m.src = m.dst;
+		m.dst = t;
+	}
+	
+	if (m.src != a)
+		memcpy(a, m.src, sizeof(int) * n);
+	free(buf);
+	free(m.bounds);
+}
+
+// 9. 平行樣本排序 (Parallel Sample Sort)
+// 抽樣選出 B-1 個分隔值，每個執行緒把自己那段分到 B 個桶（先數、再算位置、再搬），
+// 最後各桶獨立用內省排序。桶比執行緒多，讓先做完的人多領幾桶。
+#define SAMPLE_OVERSAMPLE 32
+#define SAMPLE_MAX_BUCKETS 256
+
+typedef struct {
+	int *a, *tmp;
+	unsigned char *bucket;	// 每個元素落在哪一桶，分桶時只算一次
+	int n, chunks, nb;
+	int *splitters;		// nb - 1 個，遞增
+	int *count;		// count[c * nb + b]：第 c 段落在第 b 桶的個數，之後改成寫入位置
+	int *start;		// start[b]：第 b 桶在 tmp 的起點，start[nb] = n
+} Sample_Sort;
+
+void sample_classify(void *ctx, const int c)
+{
+	Sample_Sort *s = (Sample_Sort *) ctx;
+	int lo, hi, i, b, len, half, x;
+	const int *base;
+	int *cnt = s->count + c * s->nb;
+	
+	lo = (int)((long long)s->n * c / s->chunks);
+	hi = (int)((long long)s->n * (c + 1) / s->chunks);
+	for (i = lo; i < hi; i++) {
+		// 無分支二分搜尋：桶號 = 分隔值中 <= x 的個數
+		x = s->a[i];
+		base = s->splitters;
+		for (len = s->nb - 1; len > 1; len -= half) {
+			half = len / 2;
+			base = base[half - 1] <= x ? base + half : base;
+		}
+		b = (int)(base - s->splitters) + (*base <= x);
+		s->bucket[i] = (unsigned char) b;
+		cnt[b]++;
+	}
+}
+
+void sample_scatter(void *ctx, const int c)
+{
+	Sample_Sort *s = (Sample_Sort *) ctx;
+	int lo, hi, i;
+	int *pos = s->count + c * s->nb;
+	
+	lo = (int)((long long)s->n * c / s->chunks);
+	hi = (int)((long long)s->n * (c + 1) / s->chunks);
+	for (i = lo; i < hi; i++)
+		s->tmp[pos[s->bucket[i]]++] = s->a[i];
+}
+
+void sample_sort_bucket(void *ctx, const int b)
+{
+	Sample_Sort *s = (Sample_Sort *) ctx;
+	int lo = s->start[b], len = s->start[b + 1] - s->start[b];
+	
+	intro_sort(s->tmp + lo, len);
+	memcpy(s->a + lo, s->tmp + lo, sizeof(int) * len);
+}
+
+void sample_sort(int a[], const int n)
+{
+	Sample_Sort s;
+	int *samples;
+	int T, ns, i, b, c, sum;
+	unsigned int r;
+	
+	T = pool_threads();
+	if (T == 1 || n < PAR_MIN_N) {
+		intro_sort(a, n);
+		return;
+	}
+	
+	s.a = a;
+	s.n = n;
+	s.chunks = 4 * T;
+	s.nb = 8 * T < SAMPLE_MAX_BUCKETS ? 8 * T : SAMPLE_MAX_BUCKETS;
+	ns = s.nb * SAMPLE_OVERSAMPLE;
+	s.tmp = (int *) malloc(sizeof(int) * n);
+	s.bucket = (unsigned char *) malloc(n);
+	samples = (int *) malloc(sizeof(int) * ns);
+	s.splitters = (int *) malloc(sizeof(int) * s.nb);
+	s.count = (int *) calloc((size_t)s.chunks * s.nb, sizeof(int));
+	s.start = (int *) malloc(sizeof(int) * (s.nb + 1));
+	if (!s.tmp || !s.bucket || !samples || !s.splitters || !s.count || !s.start) {
+		free(s.tmp);
+		free(s.bucket);
+		free(samples);
+		free(s.splitters);
+		free(s.count);
+		free(s.start);
+		intro_sort(a, n);
+		return;
+	}
+	
+	// 抽樣（固定的 LCG，結果可重現）並選出分隔值
+	r = 2463534242u;
+	for (i = 0; i < ns; i++) {
+		r = r * 1664525u + 1013904223u;
+		samples[i] = a[(int)(((unsigned long long)r * n) >> 32)];
+	}
+	intro_sort(samples, ns);
+	for (b = 1; b < s.nb; b++)
+		s.splitters[b - 1] = samples[b * SAMPLE_OVERSAMPLE];
+	
+	pool_run(&g_pool, s.chunks, sample_classify, &s);
+	
+	// 桶依序排，同一桶內依段的順序排：count 換成每段在每桶的寫入位置
+	sum = 0;
+	for (b = 0; b < s.nb; b++) {
+		s.start[b] = sum;
+		for (c = 0; c < s.chunks; c++) {
+			i = s.count[c * s.nb + b];
+			s.count[c * s.nb + b] = sum;
+			sum += i;
+		}
+	}
+	s.start[s.nb] = n;
+	
+	pool_run(&g_pool, s.chunks, sample_scatter, &s);
+	pool_run(&g_pool, s.nb, sample_sort_bucket, &s);
+	
+	free(s.tmp);
+	free(s.bucket);
+	free(samples);
+	free(s.splitters);
+	free(s.count);
+	free(s.start);
+}
+
+// ============================================================
+// 泛型排序 API：64 位元鍵值、鍵值對、間接排序
+// ============================================================
+// 上面的排序都是模板，任何 trivially copyable 的型別都能直接排，例如：
+//     intro_sort(keys, n, Less_Than());		// uint64_t 鍵
+//     merge_sort(recs, n, By_Key());		// 整筆紀錄照 key 排，穩定
+// 這裡補上兩種常見的形狀：鍵跟資料分成兩個陣列的鍵值對，以及紀錄太大、排序時不想整筆搬的間接排序。
+
+template <typename K, typename V>
+struct Key_Value {
+	K key;
+	V value;
+};
+
+// 只比 key 欄位，其餘欄位跟著搬
+struct By_Key {
+	template <typename P>
+	bool operator()(const P &a, const P &b) const { return a.key < b.key; }
+};
+
+// 鍵值對排序：keys[i] 與 values[i] 是一對，排完還是一對。
+// 先交錯打包成 Key_Value 陣列再排，一對只搬一次、比較時鍵旁邊就是值，不用兩個陣列各自交換；
+// 排完再拆回去。stable 非 0 時用合併排序，相同的鍵維持原本的順序。
+// 打包用的暫存區配置失敗時回傳 -1，陣列保持原狀。
+template <typename K, typename V>
+int sort_pairs(K keys[], V values[], const int n, const int stable)
+{
+	Key_Value<K, V> *p;
+	int i;
+	
+	p = (Key_Value<K, V> *) malloc(sizeof(Key_Value<K, V>) * (n > 0 ? n : 1));
+	if (p == NULL)
+		return -1;
+	for (i = 0; i < n; i++) {
+		p[i].key = keys[i];
+		p[i].value = values[i];
+	}
+	if (stable)
+		merge_sort(p, n, By_Key());
+	else
+		intro_sort(p, n, By_Key());
+	for (i = 0; i < n; i++) {
+		keys[i] = p[i].key;
+		values[i] = p[i].value;
+	}
+	free(p);
+	return 0;
+}
+
+// 間接排序的比較子：比 a[i] 與 a[j]，相等時比索引，所以結果穩定，也不會有相等的元素
+template <typename T, typename Less>
+struct By_Index {
+	const T *a;
+	Less less;
+	
+	bool operator()(const int i, const int j) const
+	{
+		if (less(a[i], a[j]))
+			return true;
+		if (less(a[j], a[i]))
+			return false;
+		return i < j;
+	}
+};
+
+// 間接排序：a 不動，idx 排成 a[idx[0]] <= a[idx[1]] <= ...。
+// 排序時只搬 4 bytes 的索引，適合幾百 bytes 的大紀錄；需要實際重排再呼叫 apply_permutation。
+template <typename T, typename Less>
+void sort_index(const T a[], int idx[], const int n, Less less)
+{
+	By_Index<T, Less> by;
+	int i;
+	
+	for (i = 0; i < n; i++)
+		idx[i] = i;
+	by.a = a;
+	by.less = less;
+	intro_sort(idx, n, by);
+}
+
+// 鍵相同比 value（索引），給 sort_index_by_key 維持穩定
+struct By_Key_Then_Value {
+	template <typename P>
+	bool operator()(const P &a, const P &b) const
+	{
+		return a.key < b.key || (!(b.key < a.key) && a.value < b.value);
+	}
+};
+
+// 紀錄有 key 欄位時的間接排序：把 (key, 索引) 抽出來排，比較時不必回頭讀整筆紀錄。
+// sort_index 每次比較都要隨機讀兩筆大紀錄，幾乎每次都是快取失誤；這裡只在抽鍵時循序讀一遍。
+// 暫存區配置失敗時退回 sort_index。
+template <typename T>
+void sort_index_by_key(const T a[], int idx[], const int n)
+{
+	Key_Value<decltype(a->key), int> *p;
+	int i;
+	
+	p = (Key_Value<decltype(a->key), int> *) malloc(sizeof(*p) * (n > 0 ? n : 1));
+	if (p == NULL) {
+		sort_index(a, idx, n, By_Key());
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		p[i].key = a[i].key;
+		p[i].value = i;
+	}
+	intro_sort(p, n, By_Key_Then_Value());
+	for (i = 0; i < n; i++)
+		idx[i] = p[i].value;
+	free(p);
+}
+
+// 照 sort_index 的結果就地重排：a[j] 換成原本的 a[idx[j]]。
+// 沿著置換的環走，每筆紀錄只搬一次，每個環多一次暫存；idx 會被改成恆等置換。
+template <typename T>
+void apply_permutation(T a[], int idx[], const int n)
+{
+	int i, j, k;
+	T t;
+	
+	for (i = 0; i < n; i++) {
+		if (idx[i] == i)
+			continue;
+		t = a[i];
+		j = i;
+		while (idx[j] != i) {
+			k = idx[j];
+			a[j] = a[k];
+			idx[j] = j;
+			j = k;
+		}
+		a[j] = t;
+		idx[j] = j;
+	}
+}
+
+// ============================================================
+// 效能測試函數
+// ============================================================
+// 每個演算法先暖身 warmup 次（不計時），再量 repeat 次，報告中位數、最小值與標準差。
+// 計時用 CLOCK_MONOTONIC 的牆上時間：clock() 解析度粗，而且會把所有執行緒的 CPU 時間加起來。
+// 加上 --perf 時另外用 perf_event_open 讀硬體計數器（只算主執行緒；平行版本的工作執行緒不含在內）。
+
+#define NUM_COUNTERS 4
+
+const char *COUNTER_NAMES[NUM_COUNTERS] = { "cycles", "instructions", "branch_misses", "cache_misses" };
+
+typedef struct {
+	int fd[NUM_COUNTERS];	// fd[0] 是 group leader
+	int ok;
+} Perf_Counters;
+
+// 輸出格式：text 是給人看的表格；csv/json 只把紀錄寫到 stdout，過程訊息改寫到 stderr
+enum { FORMAT_TEXT = 0, FORMAT_CSV, FORMAT_JSON };
+
+int out_format = FORMAT_TEXT;
+FILE *g_log;		// 給人看的訊息寫到這裡
+int g_verbose = 1;	// 0 時 test_sort 不印每一次的結果（sweep 模式自己畫表）
+
+double now_sec(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+#ifdef __linux__
+int perf_open(Perf_Counters *pc)
+{
+	static const unsigned long long config[NUM_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+	};
+	struct perf_event_attr attr;
+	int i;
+	
+	pc->ok = 0;
+	for (i = 0; i < NUM_COUNTERS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config[i];
+		attr.disabled = i == 0;		// 只有 leader 一開始關著，成員跟著 leader 開關
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		pc->fd[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : pc->fd[0], 0);
+		if (pc->fd[i] < 0) {
+			while (--i >= 0)
+				close(pc->fd[i]);
+			return -1;
+		}
+	}
+	pc->ok = 1;
+	return 0;
+}
+
+void perf_close(Perf_Counters *pc)
+{
+	int i;
+	
+	if (!pc->ok)
+		return;
+	for (i = 0; i < NUM_COUNTERS; i++)
+		close(pc->fd[i]);
+	pc->ok = 0;
+}
+
+void perf_start(Perf_Counters *pc)
+{
+	if (!pc->ok)
+		return;
+	ioctl(pc->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(pc->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perf_stop(Perf_Counters *pc, long long v[])
+{
+	int i;
+	
+	if (!pc->ok)
+		return;
+	ioctl(pc->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	for (i = 0; i < NUM_COUNTERS; i++)
+		if (read(pc->fd[i], &v[i], sizeof(v[i])) != (ssize_t) sizeof(v[i]))
+			v[i] = -1;
+}
+#else
+int perf_open(Perf_Counters *pc)
+{
+	pc->ok = 0;
+	return -1;
+}
+
+void perf_close(Perf_Counters *pc)
+{
+	(void) pc;
+}
+
+void perf_start(Perf_Counters *pc)
+{
+	(void) pc;
+}
+
+void perf_stop(Perf_Counters *pc, long long v[])
+{
+	(void) pc;
+	(void) v;
+}
+#endif
+
+int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+	
+	return (x > y) - (x < y);
+}
+
+int cmp_llong(const void *a, const void *b)
+{
+	long long x = *(const long long *) a, y = *(const long long *) b;
+	
+	return (x > y) - (x < y);
+}
+
+// 排序過的陣列取中位數（偶數個取中間兩個的平均）
+double median_of(const double v[], const int n)
+{
+	return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// 從 original 複製到 a 再排，暖身 warmup 次、計時 repeat 次；a 最後留著排好的結果
+void test_sort(const Sort_Algo *algo, const int original[], int a[], const int n,
+               const int warmup, const int repeat, Perf_Counters *pc, Sort_Result *r)
+{
+	double *times, sum, var;
+	long long *counts, v[NUM_COUNTERS];
+	int i, c;
+	
+	if (g_verbose) {
+		fprintf(g_log, "測試 %s...", algo->name);
+		fflush(g_log);
+	}
+	
+	times = (double *) malloc(sizeof(double) * repeat);
+	counts = (long long *) malloc(sizeof(long long) * repeat * NUM_COUNTERS);
+	if (times == NULL || counts == NULL) {
+		fprintf(stderr, "記憶體配置失敗！\n");
+		exit(1);
+	}
+	
+	for (i = 0; i < warmup; i++) {
+		copy_array(a, original, n);
+		algo->func(a, n);
+	}
+	
+	r->ok = 1;
+	for (i = 0; i < repeat; i++) {
+		copy_array(a, original, n);
+		perf_start(pc);
+		times[i] = now_sec();
+		algo->func(a, n);
+		times[i] = now_sec() - times[i];
+		perf_stop(pc, v);
+		for (c = 0; c < NUM_COUNTERS; c++)
+			counts[c * repeat + i] = v[c];
+		if (!is_sorted(a, n))
+			r->ok = 0;
+	}
+	
+	sum = 0;
+	for (i = 0; i < repeat; i++)
+		sum += times[i];
+	r->mean = sum / repeat;
+	var = 0;
+	for (i = 0; i < repeat; i++)
+		var += (times[i] - r->mean) * (times[i] - r->mean);
+	r->stddev = repeat > 1 ? sqrt(var / (repeat - 1)) : 0;
+	qsort(times, repeat, sizeof(double), cmp_double);
+	r->min = times[0];
+	r->time = median_of(times, repeat);
+	
+	// 計數器也取各次的中位數
+	r->has_counters = pc->ok;
+	for (c = 0; pc->ok && c < NUM_COUNTERS; c++) {
+		qsort(counts + c * repeat, repeat, sizeof(long long), cmp_llong);
+		r->counters[c] = counts[c * repeat + repeat / 2];
+	}
+	
+	strcpy(r->name, algo->name);
+	r->id = algo->id;
+	r->speedup = 0;
+	r->count = repeat;
+	
+	if (g_verbose) {
+		fprintf(g_log, r->ok ? " 正確" : " 錯誤！");
+		if (repeat > 1)
+			fprintf(g_log, " (中位數 %.4f 秒，最小 %.4f，標準差 %.4f)\n", r->time, r->min, r->stddev);
+		else
+			fprintf(g_log, " (%.4f 秒)\n", r->time);
+	}
+	
+	free(times);
+	free(counts);
+}
+
+// 機器可讀的輸出：每筆紀錄以 演算法、n、seed、data_type 為鍵
+typedef struct {
+	int n, seed, data_type, threads, key_range, warmup, repeat;
+} Run_Config;
+
+const char *data_id(const int data_type)
+{
+	return data_type >= 0 && data_type < NUM_DATA_TYPES ? DATA_IDS[data_type] : DATA_IDS[DATA_REVERSED];
+}
+
+// 一次寫一批紀錄；*count 是到目前為止寫出的筆數，0 的時候先寫 CSV 表頭或 JSON 的 '['
+void write_records(FILE *f, const Run_Config *cfg, const Sort_Result r[], const int nres, int *count)
+{
+	int i, c;
+	
+	if (*count == 0 && out_format == FORMAT_CSV) {
+		fprintf(f, "algo,n,seed,data_type,dist,threads,key_range,warmup,repeat,ok,median_s,min_s,mean_s,stddev_s,ns_per_elem,speedup");
+		for (c = 0; c < NUM_COUNTERS; c++)
+			fprintf(f, ",%s", COUNTER_NAMES[c]);
+		fputc('\n', f);
+	}
+	if (*count == 0 && out_format == FORMAT_JSON)
+		fprintf(f, "[\n");
+	
+	for (i = 0; i < nres; i++, (*count)++) {
+		if (out_format == FORMAT_CSV) {
+			fprintf(f, "%s,%d,%d,%d,%s,%d,%d,%d,%d,%d,%.9f,%.9f,%.9f,%.9f,%.3f,", r[i].id, cfg->n, cfg->seed,
+			        cfg->data_type, data_id(cfg->data_type), cfg->threads, cfg->key_range, cfg->warmup, cfg->repeat,
+			        r[i].ok, r[i].time, r[i].min, r[i].mean, r[i].stddev, r[i].time * 1e9 / cfg->n);
+			if (r[i].speedup > 0)
+				fprintf(f, "%.4f", r[i].speedup);
+			for (c = 0; c < NUM_COUNTERS; c++) {
+				fputc(',', f);
+				if (r[i].has_counters)
+					fprintf(f, "%lld", r[i].counters[c]);
+			}
+			fputc('\n', f);
+			continue;
+		}
+		
+		fprintf(f, "%s  {\"algo\": \"%s\", \"n\": %d, \"seed\": %d, \"data_type\": %d, \"dist\": \"%s\", \"threads\": %d, "
+		        "\"key_range\": %d, \"warmup\": %d, \"repeat\": %d, \"ok\": %s, \"median_s\": %.9f, \"min_s\": %.9f, "
+		        "\"mean_s\": %.9f, \"stddev_s\": %.9f, \"ns_per_elem\": %.3f, ",
+		        *count > 0 ? ",\n" : "", r[i].id, cfg->n, cfg->seed, cfg->data_type, data_id(cfg->data_type),
+		        cfg->threads, cfg->key_range, cfg->warmup, cfg->repeat, r[i].ok ? "true" : "false",
+		        r[i].time, r[i].min, r[i].mean, r[i].stddev, r[i].time * 1e9 / cfg->n);
+		if (r[i].speedup > 0)
+			fprintf(f, "\"speedup\": %.4f", r[i].speedup);
+		else
+			fprintf(f, "\"speedup\": null");
+		for (c = 0; c < NUM_COUNTERS; c++) {
+			if (r[i].has_counters)
+				fprintf(f, ", \"%s\": %lld", COUNTER_NAMES[c], r[i].counters[c]);
+			else
+				fprintf(f, ", \"%s\": null", COUNTER_NAMES[c]);
+		}
+		fputc('}', f);
+	}
+}
+
+void finish_records(FILE *f, const int count)
+{
+	if (out_format == FORMAT_JSON)
+		fprintf(f, count > 0 ? "\n]\n" : "[]\n");
+}
+
+static const Sort_Algo algos[] = {
+	{ "insertion", "插入排序", insertion_sort, NULL },
+	{ "selection", "選擇排序", selection_sort, NULL },
+	{ "quick", "快速排序", quick_sort, NULL },
+	{ "merge", "合併排序", merge_sort, NULL },
+	{ "heap", "堆積排序", heap_sort, NULL },
+	{ "heap_bu", "自底向上堆積", heap_sort_bu, NULL },
+	{ "heap4", "四元堆積排序", heap4_sort, NULL },
+	{ "intro", "內省排序", intro_sort, NULL },
+	{ "merge_bu", "自底向上合併", merge_sort_bu, NULL },
+	{ "radix", "LSD基數排序", radix_sort_lsd, NULL },
+	{ "flag", "MSD基數排序", american_flag_sort, NULL },
+	{ "par_merge", "平行合併排序", par_merge_sort, "merge_bu" },
+	{ "sample", "平行樣本排序", sample_sort, "intro" },
+};
+
+#define NUM_ALGOS ((int)(sizeof(algos) / sizeof(algos[0])))
+
+const Sort_Algo *find_algo(const char *id)
+{
+	int i;
+	
+	for (i = 0; i < NUM_ALGOS; i++)
+		if (strcmp(algos[i].id, id) == 0)
+			return &algos[i];
+	return NULL;
+}
+
+// list 是逗號分隔的 id，NULL 或其中有 "all" 代表全部
+int algo_selected(const char *list, const char *id)
+{
+	const char *p, *e;
+	size_t len;
+	
+	if (list == NULL)
+		return 1;
+	
+	len = strlen(id);
+	for (p = list; *p; p = *e ? e + 1 : e) {
+		e = strchr(p, ',');
+		if (e == NULL)
+			e = p + strlen(p);
+		if ((size_t)(e - p) == len && strncmp(p, id, len) == 0)
+			return 1;
+		if (e - p == 3 && strncmp(p, "all", 3) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+// list 裡每個名字都要是 algos[] 的 id 或 "all"（空的名字也不行）；
+// 不認得的第一個名字印到 stderr，回傳 0
+int algo_list_valid(const char *list)
+{
+	const char *p, *e;
+	int i, ok;
+	
+	p = list;
+	for (;;) {
+		e = strchr(p, ',');
+		if (e == NULL)
+			e = p + strlen(p);
+		ok = e - p == 3 && strncmp(p, "all", 3) == 0;
+		for (i = 0; i < NUM_ALGOS && !ok; i++)
+			ok = strlen(algos[i].id) == (size_t)(e - p) && strncmp(p, algos[i].id, e - p) == 0;
+		if (!ok) {
+			fprintf(stderr, "不認得的演算法：\"%.*s\"\n", (int)(e - p), p);
+			return 0;
+		}
+		if (*e == '\0')
+			return 1;
+		p = e + 1;
+	}
+}
+
+// 葉節點微基準：./p2 --leaf [輪數]
+// 各種大小的小區段用插入排序與 sort_small 各排一遍，報告每個元素的成本；另外比較兩種兩段合併。
+int bench_leaf(const int rounds)
+{
+	static const int sizes[] = { 8, 12, 16, 24, 32, 48, 64 };
+	int *src, *a, *b, *dst;
+	int nblocks, total, s, i, n, r, bad;
+	double t0, t_ins, t_net;
+	
+	nblocks = 4096;
+	total = nblocks * SMALL_SORT_MAX;
+	src = (int *) malloc(sizeof(int) * total);
+	a = (int *) malloc(sizeof(int) * total);
+	b = (int *) malloc(sizeof(int) * total);
+	dst = (int *) malloc(sizeof(int) * total * 2);
+	if (!src || !a || !b || !dst) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	srandom(1);
+	for (i = 0; i < total; i++)
+		src[i] = random();
+	
+	printf("葉節點排序：每種大小 %d 塊 × %d 輪，%s\n", nblocks, rounds, has_avx2() ? "AVX2 排序網路" : "沒有 AVX2，sort_small 即插入排序");
+	printf("-------------------------------------------------\n");
+	printf("%6s %16s %16s %8s\n", "大小", "插入(ns/elem)", "網路(ns/elem)", "倍數");
+	
+	bad = 0;
+	for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+		n = sizes[s];
+		t_ins = t_net = 0;
+		for (r = 0; r < rounds; r++) {
+			memcpy(a, src, sizeof(int) * total);
+			memcpy(b, src, sizeof(int) * total);
+			t0 = now_sec();
+			for (i = 0; i < nblocks; i++)
+				insertion_sort(a + i * n, n);
+			t_ins += now_sec() - t0;
+			t0 = now_sec();
+			for (i = 0; i < nblocks; i++)
+				sort_small(b + i * n, n);
+			t_net += now_sec() - t0;
+		}
+		if (memcmp(a, b, sizeof(int) * nblocks * n) != 0)
+			bad = 1;
+		printf("%6d %16.2f %16.2f %7.1fx\n", n, t_ins * 1e9 / ((double)rounds * nblocks * n),
+		       t_net * 1e9 / ((double)rounds * nblocks * n), t_ins / t_net);
+	}
+	
+	// 兩段各 total 個的合併
+	memcpy(a, src, sizeof(int) * total);
+	memcpy(b, src, sizeof(int) * total);
+	radix_sort_lsd(a, total);
+	for (i = 0; i < total; i++)
+		b[i] = (int)((unsigned int)src[i] >> 1);
+	radix_sort_lsd(b, total);
+	t_ins = t_net = 0;
+	for (r = 0; r < rounds; r++) {
+		t0 = now_sec();
+		merge_two_scalar(a, total, b, total, dst);
+		t_ins += now_sec() - t0;
+		t0 = now_sec();
+		merge_two(a, total, b, total, dst);
+		t_net += now_sec() - t0;
+	}
+	if (!is_sorted(dst, 2 * total))
+		bad = 1;
+	printf("-------------------------------------------------\n");
+	printf("合併 2×%d：純量 %.2f ns/elem、merge_two %.2f ns/elem（%.1fx）\n", total,
+	       t_ins * 1e9 / ((double)rounds * 2 * total), t_net * 1e9 / ((double)rounds * 2 * total), t_ins / t_net);
+	printf("結果%s\n", bad ? "不一致！" : "一致");
+	
+	free(src);
+	free(a);
+	free(b);
+	free(dst);
+	return bad;
+}
+
+// 泛型 API 微基準用的大紀錄：8 bytes 鍵 + 248 bytes 資料
+typedef struct {
+	uint64_t key;
+	uint64_t data[31];
+} Big_Record;
+
+int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+	
+	return (x > y) - (x < y);
+}
+
+int cmp_record(const void *a, const void *b)
+{
+	return cmp_u64(&((const Big_Record *) a)->key, &((const Big_Record *) b)->key);
+}
+
+static inline uint64_t random_u64(void)
+{
+	return ((uint64_t) random() << 33) ^ ((uint64_t) random() << 11) ^ (uint64_t) random();
+}
+
+// 鍵值對的資料由鍵算出來，排完可以檢查每一對有沒有拆散
+static inline uint64_t payload_of(const uint64_t key)
+{
+	return key * 0x9E3779B97F4A7C15ULL + 1;
+}
+
+// 泛型 API 微基準：./p2 --typed [n]
+// 1. uint64_t 鍵：qsort（每次比較都經過函數指標）對模板 intro_sort（比較子 inline）
+// 2. 鍵值對：sort_pairs 的不穩定與穩定版本
+// 3. 256 bytes 的紀錄（n / 8 筆）：qsort、直接 intro_sort 整筆搬，對 sort_index + apply_permutation
+int bench_typed(const int n)
+{
+	uint64_t *src, *a, *b, *vals;
+	Big_Record *recs, *orig;
+	int *idx;
+	int nrec, i, j, bad;
+	double t0, t_ref, t;
+	
+	nrec = n / 8 > 1 ? n / 8 : 1;
+	src = (uint64_t *) malloc(sizeof(uint64_t) * n);
+	a = (uint64_t *) malloc(sizeof(uint64_t) * n);
+	b = (uint64_t *) malloc(sizeof(uint64_t) * n);
+	vals = (uint64_t *) malloc(sizeof(uint64_t) * n);
+	orig = (Big_Record *) malloc(sizeof(Big_Record) * nrec);
+	recs = (Big_Record *) malloc(sizeof(Big_Record) * nrec);
+	idx = (int *) malloc(sizeof(int) * nrec);
+	if (!src || !a || !b || !vals || !orig || !recs || !idx) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	srandom(1);
+	for (i = 0; i < n; i++)
+		src[i] = random_u64();
+	for (i = 0; i < nrec; i++) {
+		orig[i].key = random_u64() % (nrec / 4 + 1);	// 故意留重複鍵
+		for (j = 0; j < 31; j++)
+			orig[i].data[j] = orig[i].key + j;
+	}
+	
+	printf("泛型排序：%d 個 uint64_t 鍵、%d 筆 %d bytes 紀錄\n", n, nrec, (int) sizeof(Big_Record));
+	printf("-------------------------------------------------\n");
+	bad = 0;
+	
+	memcpy(a, src, sizeof(uint64_t) * n);
+	t0 = now_sec();
+	qsort(a, n, sizeof(uint64_t), cmp_u64);
+	t_ref = now_sec() - t0;
+	printf("%-34s %8.2f ns/elem\n", "qsort (uint64_t)", t_ref * 1e9 / n);
+	
+	memcpy(b, src, sizeof(uint64_t) * n);
+	t0 = now_sec();
+	intro_sort(b, n, Less_Than());
+	t = now_sec() - t0;
+	printf("%-34s %8.2f ns/elem  %5.1fx\n", "intro_sort<uint64_t>", t * 1e9 / n, t_ref / t);
+	if (memcmp(a, b, sizeof(uint64_t) * n) != 0)
+		bad = 1;
+	
+	for (j = 0; j < 2; j++) {
+		memcpy(b, src, sizeof(uint64_t) * n);
+		for (i = 0; i < n; i++)
+			vals[i] = payload_of(b[i]);
+		t0 = now_sec();
+		if (sort_pairs(b, vals, n, j) != 0)
+			bad = 1;
+		t = now_sec() - t0;
+		printf("%-34s %8.2f ns/elem  %5.1fx\n", j ? "sort_pairs (stable)" : "sort_pairs", t * 1e9 / n, t_ref / t);
+		if (memcmp(a, b, sizeof(uint64_t) * n) != 0)
+			bad = 1;
+		for (i = 0; i < n; i++)
+			if (vals[i] != payload_of(b[i]))
+				bad = 1;
+	}
+	
+	printf("-------------------------------------------------\n");
+	memcpy(recs, orig, sizeof(Big_Record) * nrec);
+	t0 = now_sec();
+	qsort(recs, nrec, sizeof(Big_Record), cmp_record);
+	t_ref = now_sec() - t0;
+	printf("%-34s %8.2f ns/elem\n", "qsort (Big_Record)", t_ref * 1e9 / nrec);
+	
+	memcpy(recs, orig, sizeof(Big_Record) * nrec);
+	t0 = now_sec();
+	intro_sort(recs, nrec, By_Key());
+	t = now_sec() - t0;
+	printf("%-34s %8.2f ns/elem  %5.1fx\n", "intro_sort<Big_Record>", t * 1e9 / nrec, t_ref / t);
+	for (i = 0; i < nrec; i++)
+		if ((i > 0 && recs[i - 1].key > recs[i].key) || recs[i].data[30] != recs[i].key + 30)
+			bad = 1;
+	
+	memcpy(recs, orig, sizeof(Big_Record) * nrec);
+	t0 = now_sec();
+	sort_index(recs, idx, nrec, By_Key());
+	apply_permutation(recs, idx, nrec);
+	t = now_sec() - t0;
+	printf("%-34s %8.2f ns/elem  %5.1fx\n", "sort_index + apply_permutation", t * 1e9 / nrec, t_ref / t);
+	for (i = 0; i < nrec; i++)
+		if ((i > 0 && recs[i - 1].key > recs[i].key) || recs[i].data[30] != recs[i].key + 30)
+			bad = 1;
+	
+	memcpy(recs, orig, sizeof(Big_Record) * nrec);
+	t0 = now_sec();
+	sort_index_by_key(recs, idx, nrec);
+	apply_permutation(recs, idx, nrec);
+	t = now_sec() - t0;
+	printf("%-34s %8.2f ns/elem  %5.1fx\n", "sort_index_by_key + apply_perm", t * 1e9 / nrec, t_ref / t);
+	for (i = 0; i < nrec; i++)
+		if ((i > 0 && recs[i - 1].key > recs[i].key) || recs[i].data[30] != recs[i].key + 30)
+			bad = 1;
+	
+	printf("-------------------------------------------------\n");
+	printf("結果%s\n", bad ? "不一致！" : "一致");
+	
+	free(src);
+	free(a);
+	free(b);
+	free(vals);
+	free(orig);
+	free(recs);
+	free(idx);
+	return bad;
+}
+
+// 平行版本的加速比：對照同一批結果裡的單執行緒基準（基準沒跑就不算）
+void compute_speedups(Sort_Result r[], const int nres)
+{
+	int i, j;
+	const char *base_id;
+	
+	for (i = 0; i < nres; i++) {
+		base_id = find_algo(r[i].id)->base_id;
+		for (j = 0; base_id && j < nres; j++)
+			if (strcmp(r[j].id, base_id) == 0 && r[i].time > 0)
+				r[i].speedup = r[j].time / r[i].time;
+	}
+}
+
+// 掃描模式：n 從 nmin 每次乘 factor 到 nmax，每種分布各畫一張 ns/element 的表。
+// 某個演算法在某種分布上一旦超過 budget 秒（或照目前的成長率推估下一個 n 會超過 2 倍 budget），
+// 之後更大的 n 就不再跑它，表上印 "-"。
+typedef struct {
+	int nmin, nmax, factor;
+	double budget;
+} Sweep_Config;
+
+int run_sweep(const Sweep_Config *sw, Run_Config *cfg, const char *only, const int warmup, const int repeat, Perf_Counters *pc)
+{
+	int *original, *temp;
+	int skip[NUM_ALGOS];
+	double last[NUM_ALGOS], est;
+	Sort_Result results[NUM_ALGOS];
+	int d, i, n, nres, nrec;
+	
+	original = (int *) malloc(sizeof(int) * sw->nmax);
+	temp = (int *) malloc(sizeof(int) * sw->nmax);
+	if (original == NULL || temp == NULL) {
+		fprintf(stderr, "記憶體配置失敗！\n");
+		return 1;
+	}
+	
+	nrec = 0;
+	for (d = 0; d < NUM_DATA_TYPES; d++) {
+		fprintf(g_log, "\n%s（ns/element，每格是 %d 次的中位數；預算 %.1f 秒）\n", DATA_NAMES[d], repeat, sw->budget);
+		fprintf(g_log, "%10s", "n");
+		for (i = 0; i < NUM_ALGOS; i++) {
+			skip[i] = !algo_selected(only, algos[i].id);
+			last[i] = 0;
+			if (!skip[i])
+				fprintf(g_log, " %10s", algos[i].id);
+		}
+		fputc('\n', g_log);
+		
+		for (n = sw->nmin; n <= sw->nmax; n = n > sw->nmax / sw->factor ? sw->nmax + 1 : n * sw->factor) {
+			generate_data(original, n, d, cfg->seed);
+			fprintf(g_log, "%10d", n);
+			nres = 0;
+			for (i = 0; i < NUM_ALGOS; i++) {
+				if (!algo_selected(only, algos[i].id))
+					continue;
+				if (skip[i]) {
+					fprintf(g_log, " %10s", "-");
+					continue;
+				}
+				test_sort(&algos[i], original, temp, n, warmup, repeat, pc, &results[nres]);
+				fprintf(g_log, results[nres].ok ? " %10.2f" : " %9.2f!", results[nres].time * 1e9 / n);
+				fflush(g_log);
+				
+				// 下一個 n 的推估：至少線性成長，若實際成長得更快就照實際的比例
+				est = results[nres].time * sw->factor;
+				if (last[i] > 0 && results[nres].time / last[i] > sw->factor)
+					est = results[nres].time * (results[nres].time / last[i]);
+				if (results[nres].time > sw->budget || est > 2 * sw->budget)
+					skip[i] = 1;
+				last[i] = results[nres].time;
+				nres++;
+			}
+			fputc('\n', g_log);
+			
+			compute_speedups(results, nres);
+			cfg->n = n;
+			cfg->data_type = d;
+			if (out_format != FORMAT_TEXT)
+				write_records(stdout, cfg, results, nres, &nrec);
+		}
+	}
+	if (out_format != FORMAT_TEXT)
+		finish_records(stdout, nrec);
+	
+	free(original);
+	free(temp);
+	return 0;
+}
+
+// ============================================================
+// 外部排序：資料比記憶體大的時候
+// ============================================================
+// 檔案就是原生位元組序的 int 陣列，沒有檔頭。
+//   ./p2 --ext-gen 檔案 n [seed]			產生 n 個隨機 int
+//   ./p2 --ext-sort 輸入 輸出 [--mem=MB] [--tmpdir=目錄]
+//   ./p2 --ext-bench [倍數] [--mem=MB] [--tmpdir=目錄]	產生 倍數×mem（預設 4 倍）的資料、排序、驗證
+// 第一階段每次讀 mem/3 的資料用 radix_sort_lsd 排成一段，寫進 tmpdir 的暫存檔
+// （另外兩份記憶體是基數排序的暫存區，以及在背景預讀的下一段）；
+// 第二階段用敗者樹 (loser tree) 做 k 路合併，段數超過 fan-in 就先分組合併成比較少的長段，再合併一趟。
+// 所有讀寫都丟給一條 I/O 執行緒用 pread/pwrite 做；每個串流有兩塊緩衝區，
+// 合併在吃其中一塊的時候，另一塊已經在背景讀（或寫）了。
+
+#define EXT_MEM_MB 64			// 預設記憶體預算
+#define EXT_MIN_BUF (256 * 1024)	// 合併時每塊緩衝區至少這麼大，由此決定 fan-in
+
+typedef struct Io_Req {
+	int fd;
+	int is_write;
+	char *buf;
+	size_t len;
+	off_t off;
+	ssize_t done;		// 實際讀寫的 bytes，-1 是錯誤
+	int pending;
+	struct Io_Req *next;
+} Io_Req;
+
+typedef struct {
+	pthread_t tid;
+	pthread_mutex_t mu;
+	pthread_cond_t wake, done;
+	Io_Req *head, *tail;
+	int stop;
+	int error;
+	long long bytes_read, bytes_written;
+} Io_Queue;
+
+static Io_Queue g_io;
+
+typedef struct {
+	size_t mem;		// 記憶體預算 (bytes)
+	const char *tmpdir;
+} Ext_Config;
+
+typedef struct {
+	long long n;		// 元素個數
+	int runs, passes, fan_in;
+	double t_runs, t_merge;
+	long long bytes_read, bytes_written;
+} Ext_Stats;
+
+typedef struct {
+	int fd;
+	off_t bytes;
+} Ext_Run;
+
+// 讀滿或寫完 len bytes（遇到檔尾才會少）
+ssize_t io_full(const Io_Req *r)
+{
+	size_t got;
+	ssize_t k;
+	
+	got = 0;
+	while (got < r->len) {
+		if (r->is_write)
+			k = pwrite(r->fd, r->buf + got, r->len - got, r->off + got);
+		else
+			k = pread(r->fd, r->buf + got, r->len - got, r->off + got);
+		if (k < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (k == 0)
+			break;
+		got += k;
+	}
+	return got;
+}
+
+void *io_worker(void *arg)
+{
+	Io_Queue *q = (Io_Queue *) arg;
+	Io_Req *r;
+	ssize_t k;
+	
+	pthread_mutex_lock(&q->mu);
+	for (;;) {
+		while (q->head == NULL && !q->stop)
+			pthread_cond_wait(&q->wake, &q->mu);
+		if (q->head == NULL)
+			break;
+		r = q->head;
+		q->head = r->next;
+		if (q->head == NULL)
+			q->tail = NULL;
+		pthread_mutex_unlock(&q->mu);
+	
+		k = io_full(r);
+	
+		pthread_mutex_lock(&q->mu);
+		r->done = k;
+		r->pending = 0;
+		if (k < 0 || (r->is_write && (size_t) k != r->len))
+			q->error = 1;
+		else if (r->is_write)
+			q->bytes_written += k;
+		else
+			q->bytes_read += k;
+		pthread_cond_broadcast(&q->done);
+	}
+	pthread_mutex_unlock(&q->mu);
+	return NULL;
+}
+
+int io_start(Io_Queue *q)
+{
+	memset(q, 0, sizeof(*q));
+	pthread_mutex_init(&q->mu, NULL);
+	pthread_cond_init(&q->wake, NULL);
+	pthread_cond_init(&q->done, NULL);
+	if (pthread_create(&q->tid, NULL, io_worker, q) != 0) {
+		pthread_mutex_destroy(&q->mu);
+		pthread_cond_destroy(&q->wake);
+		pthread_cond_destroy(&q->done);
+		return -1;
+	}
+	return 0;
+}
+
+void io_stop(Io_Queue *q)
+{
+	pthread_mutex_lock(&q->mu);
+	q->stop = 1;
+	pthread_cond_signal(&q->wake);
+	pthread_mutex_unlock(&q->mu);
+	pthread_join(q->tid, NULL);
+	pthread_mutex_destroy(&q->mu);
+	pthread_cond_destroy(&q->wake);
+	pthread_cond_destroy(&q->done);
+}
+
+// 排進佇列就回來，照送出的順序一個一個做
+void io_submit(Io_Queue *q, Io_Req *r, const int fd, const int is_write, void *buf, const size_t len, const off_t off)
+{
+	r->fd = fd;
+	r->is_write = is_write;
+	r->buf = (char *) buf;
+	r->len = len;
+	r->off = off;
+	r->done = 0;
+	r->next = NULL;
+	if (len == 0) {
+		r->pending = 0;
+		return;
+	}
+	pthread_mutex_lock(&q->mu);
+	r->pending = 1;
+	if (q->tail)
+		q->tail->next = r;
+	else
+		q->head = r;
+	q->tail = r;
+	pthread_cond_signal(&q->wake);
+	pthread_mutex_unlock(&q->mu);
+}
+
+ssize_t io_wait(Io_Queue *q, Io_Req *r)
+{
+	pthread_mutex_lock(&q->mu);
+	while (r->pending)
+		pthread_cond_wait(&q->done, &q->mu);
+	pthread_mutex_unlock(&q->mu);
+	return r->done;
+}
+
+// 雙緩衝的循序讀取：吃 buf[cur] 的時候，buf[cur ^ 1] 在背景讀
+typedef struct {
+	int fd;
+	off_t off, end;		// 下一次要讀的位置、串流結尾
+	size_t cap;		// 每塊緩衝區的 bytes
+	int *buf[2];
+	Io_Req req[2];
+	int cur, pos, n;
+} Ext_Reader;
+
+void ext_reader_fill(Ext_Reader *r, const int b)
+{
+	size_t len;
+	
+	len = r->end - r->off < (off_t) r->cap ? (size_t)(r->end - r->off) : r->cap;
+	io_submit(&g_io, &r->req[b], r->fd, 0, r->buf[b], len, r->off);
+	r->off += len;
+}
+
+// 目前這塊吃完了：把它丟回去背景讀，換另一塊
+int ext_reader_next(Ext_Reader *r)
+{
+	ssize_t k;
+	
+	ext_reader_fill(r, r->cur);
+	r->cur ^= 1;
+	k = io_wait(&g_io, &r->req[r->cur]);
+	r->n = k > 0 ? (int)(k / sizeof(int)) : 0;
+	r->pos = 0;
+	return r->n > 0;
+}
+
+int ext_reader_open(Ext_Reader *r, const int fd, const off_t start, const off_t end, const size_t cap)
+{
+	ssize_t k;
+	
+	memset(r, 0, sizeof(*r));
+	r->fd = fd;
+	r->off = start;
+	r->end = end;
+	r->cap = cap;
+	r->buf[0] = (int *) malloc(cap);
+	r->buf[1] = (int *) malloc(cap);
+	if (r->buf[0] == NULL || r->buf[1] == NULL) {
+		free(r->buf[0]);
+		free(r->buf[1]);
+		return -1;
+	}
+	ext_reader_fill(r, 0);
+	ext_reader_fill(r, 1);
+	k = io_wait(&g_io, &r->req[0]);
+	r->n = k > 0 ? (int)(k / sizeof(int)) : 0;
+	return 0;
+}
+
+// 下一個元素；讀完回傳 LLONG_MAX，比任何 int 都大，合併時就自然沉到最後
+static inline long long ext_reader_get(Ext_Reader *r)
+{
+	if (r->pos == r->n && !ext_reader_next(r))
+		return LLONG_MAX;
+	return r->buf[r->cur][r->pos++];
+}
+
+void ext_reader_close(Ext_Reader *r)
+{
+	io_wait(&g_io, &r->req[0]);
+	io_wait(&g_io, &r->req[1]);
+	free(r->buf[0]);
+	free(r->buf[1]);
+}
+
+// 雙緩衝的循序寫入：一塊寫滿就丟給 I/O 執行緒，換另一塊繼續填
+typedef struct {
+	int fd;
+	off_t off;
+	int cap_n;		// 每塊緩衝區的元素個數
+	int *buf[2];
+	Io_Req req[2];
+	int cur, n;
+} Ext_Writer;
+
+int ext_writer_open(Ext_Writer *w, const int fd, const size_t cap)
+{
+	memset(w, 0, sizeof(*w));
+	w->fd = fd;
+	w->cap_n = (int)(cap / sizeof(int));
+	w->buf[0] = (int *) malloc(cap);
+	w->buf[1] = (int *) malloc(cap);
+	if (w->buf[0] == NULL || w->buf[1] == NULL) {
+		free(w->buf[0]);
+		free(w->buf[1]);
+		return -1;
+	}
+	return 0;
+}
+
+void ext_writer_flush(Ext_Writer *w)
+{
+	size_t len;
+	
+	len = (size_t) w->n * sizeof(int);
+	io_submit(&g_io, &w->req[w->cur], w->fd, 1, w->buf[w->cur], len, w->off);
+	w->off += len;
+	w->cur ^= 1;
+	io_wait(&g_io, &w->req[w->cur]);	// 另一塊上一次的寫入要先做完才能重填
+	w->n = 0;
+}
+
+static inline void ext_writer_put(Ext_Writer *w, const int x)
+{
+	w->buf[w->cur][w->n++] = x;
+	if (w->n == w->cap_n)
+		ext_writer_flush(w);
+}
+
+// 回傳寫出的總 bytes
+off_t ext_writer_close(Ext_Writer *w)
+{
+	if (w->n > 0)
+		ext_writer_flush(w);
+	io_wait(&g_io, &w->req[0]);
+	io_wait(&g_io, &w->req[1]);
+	free(w->buf[0]);
+	free(w->buf[1]);
+	return w->off;
+}
+
+// tmpdir 底下的暫存檔；建好馬上 unlink，fd 關掉就消失，中途當掉也不會留垃圾
+int ext_temp_file(const char *dir)
+{
+	char path[4096];
+	int fd;
+	
+	snprintf(path, sizeof(path), "%s/p2-run-XXXXXX", dir);
+	fd = mkstemp(path);
+	if (fd >= 0)
+		unlink(path);
+	return fd;
+}
+
+// 第一階段：切成 mem/3 大小的段，排好寫進暫存檔。
+// 排第 i 段的時候第 i+1 段已經在背景讀，第 i-1 段在背景寫。
+int ext_make_runs(const int in, const off_t size, const Ext_Config *cfg, Ext_Run **runs_out, int *nruns)
+{
+	Ext_Run *runs;
+	Io_Req rreq[2], wreq[2];
+	int *buf[2];
+	size_t run_bytes, len;
+	off_t off;
+	ssize_t got;
+	int cur, nr, maxr, fd, err;
+	
+	*runs_out = NULL;
+	*nruns = 0;
+	run_bytes = cfg->mem / 3 / 4096 * 4096;
+	if (run_bytes < 4096)
+		run_bytes = 4096;
+	maxr = (int)(size / (off_t) run_bytes) + 1;
+	runs = (Ext_Run *) malloc(sizeof(Ext_Run) * maxr);
+	buf[0] = (int *) malloc(run_bytes);
+	buf[1] = (int *) malloc(run_bytes);
+	if (runs == NULL || buf[0] == NULL || buf[1] == NULL) {
+		free(runs);
+		free(buf[0]);
+		free(buf[1]);
+		return -1;
+	}
+	memset(rreq, 0, sizeof(rreq));
+	memset(wreq, 0, sizeof(wreq));
+	
+	nr = 0;
+	err = 0;
+	off = 0;
+	cur = 0;
+	len = size - off < (off_t) run_bytes ? (size_t)(size - off) : run_bytes;
+	io_submit(&g_io, &rreq[0], in, 0, buf[0], len, off);
+	off += len;
+	for (;;) {
+		got = io_wait(&g_io, &rreq[cur]);
+		if (got < 0)
+			err = 1;
+		if (got <= 0)
+			break;
+	
+		// 預讀下一段；那塊緩衝區上一段的寫入要先做完
+		io_wait(&g_io, &wreq[cur ^ 1]);
+		len = size - off < (off_t) run_bytes ? (size_t)(size - off) : run_bytes;
+		io_submit(&g_io, &rreq[cur ^ 1], in, 0, buf[cur ^ 1], len, off);
+		off += len;
+	
+		radix_sort_lsd(buf[cur], (int)(got / sizeof(int)));
+		fd = ext_temp_file(cfg->tmpdir);
+		if (fd < 0) {
+			err = 1;
+			break;
+		}
+		runs[nr].fd = fd;
+		runs[nr].bytes = got;
+		nr++;
+		io_submit(&g_io, &wreq[cur], fd, 1, buf[cur], got, 0);
+		cur ^= 1;
+	}
+	io_wait(&g_io, &rreq[0]);
+	io_wait(&g_io, &rreq[1]);
+	io_wait(&g_io, &wreq[0]);
+	io_wait(&g_io, &wreq[1]);
+	free(buf[0]);
+	free(buf[1]);
+	
+	*runs_out = runs;
+	*nruns = nr;
+	return err ? -1 : 0;
+}
+
+// 敗者樹：tree[1..k) 存各場比賽的輸家，tree[0] 是總冠軍（目前最小的段）。
+// 葉子 s 的父節點是 (s + k) / 2；-1 代表還沒填的位置，當成負無限大。
+// 換掉冠軍之後只要沿著它的路徑往上比一次，log k 次比較，而且不用像堆積一樣每層比兩次。
+static inline void loser_adjust(int tree[], const long long key[], const int k, int s)
+{
+	int t, x;
+	
+	for (t = (s + k) / 2; t > 0; t /= 2) {
+		x = tree[t];
+		if (s >= 0 && (x < 0 || key[x] < key[s])) {
+			tree[t] = s;
+			s = x;
+		}
+	}
+	tree[0] = s;
+}
+
+// 把 runs[0..k) 合併寫進 out；每個串流兩塊 cap bytes 的緩衝區。回傳寫出的 bytes，失敗回傳 -1
+off_t ext_merge(const Ext_Run runs[], int k, const int out, const size_t cap)
+{
+	Ext_Reader *in;
+	Ext_Writer w;
+	long long *key;
+	int *tree;
+	int i, s, err;
+	off_t bytes;
+	
+	in = (Ext_Reader *) malloc(sizeof(Ext_Reader) * (k > 0 ? k : 1));
+	key = (long long *) malloc(sizeof(long long) * (k > 0 ? k : 1));
+	tree = (int *) malloc(sizeof(int) * (k > 0 ? k : 1));
+	if (in == NULL || key == NULL || tree == NULL || ext_writer_open(&w, out, cap) != 0) {
+		free(in);
+		free(key);
+		free(tree);
+		return -1;
+	}
+	
+	err = 0;
+	for (i = 0; i < k; i++) {
+		if (ext_reader_open(&in[i], runs[i].fd, 0, runs[i].bytes, cap) != 0) {
+			err = 1;
+			k = i;
+			break;
+		}
+		key[i] = ext_reader_get(&in[i]);
+	}
+	if (!err && k > 0) {
+		for (i = 0; i < k; i++)
+			tree[i] = -1;
+		for (i = 0; i < k; i++)
+			loser_adjust(tree, key, k, i);
+	
+		while (key[s = tree[0]] != LLONG_MAX) {
+			ext_writer_put(&w, (int) key[s]);
+			key[s] = ext_reader_get(&in[s]);
+			loser_adjust(tree, key, k, s);
+		}
+	}
+	
+	for (i = 0; i < k; i++)
+		ext_reader_close(&in[i]);
+	bytes = ext_writer_close(&w);
+	free(in);
+	free(key);
+	free(tree);
+	return err ? -1 : bytes;
+}
+
+// 合併 k 段時每塊緩衝區的大小：k 個輸入加一個輸出，各兩塊
+size_t ext_merge_cap(const Ext_Config *cfg, const int k)
+{
+	size_t cap;
+	
+	cap = cfg->mem / (2 * ((size_t) k + 1)) / 4096 * 4096;
+	return cap < 4096 ? 4096 : cap;
+}
+
+int ext_sort_file(const char *in_path, const char *out_path, const Ext_Config *cfg, Ext_Stats *st)
+{
+	Ext_Run *runs, *next;
+	struct stat sb;
+	int in, out, nruns, nnext, i, g, cnt, fd, err;
+	off_t bytes;
+	double t0;
+	
+	memset(st, 0, sizeof(*st));
+	in = open(in_path, O_RDONLY);
+	if (in < 0 || fstat(in, &sb) != 0 || sb.st_size % sizeof(int) != 0) {
+		fprintf(stderr, "無法讀取 %s，或大小不是 %d 的倍數\n", in_path, (int) sizeof(int));
+		if (in >= 0)
+			close(in);
+		return -1;
+	}
+	out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out < 0 || io_start(&g_io) != 0) {
+		fprintf(stderr, "無法寫入 %s\n", out_path);
+		close(in);
+		if (out >= 0)
+			close(out);
+		return -1;
+	}
+	st->n = sb.st_size / sizeof(int);
+	
+	t0 = now_sec();
+	err = ext_make_runs(in, sb.st_size, cfg, &runs, &nruns) != 0;
+	close(in);
+	st->t_runs = now_sec() - t0;
+	st->runs = nruns;
+	st->fan_in = (int)(cfg->mem / (2 * EXT_MIN_BUF)) - 1;
+	if (st->fan_in < 2)
+		st->fan_in = 2;
+	
+	// 段數太多就先分組合併，直到一趟合得完
+	t0 = now_sec();
+	while (!err && nruns > st->fan_in) {
+		next = (Ext_Run *) malloc(sizeof(Ext_Run) * (nruns / st->fan_in + 1));
+		if (next == NULL) {
+			err = 1;
+			break;
+		}
+		nnext = 0;
+		for (g = 0; g < nruns; g += cnt) {
+			cnt = nruns - g < st->fan_in ? nruns - g : st->fan_in;
+			fd = ext_temp_file(cfg->tmpdir);
+			bytes = fd < 0 ? -1 : ext_merge(runs + g, cnt, fd, ext_merge_cap(cfg, cnt));
+			for (i = g; i < g + cnt; i++)
+				close(runs[i].fd);
+			if (bytes < 0) {
+				err = 1;
+				if (fd >= 0)
+					close(fd);
+				continue;
+			}
+			next[nnext].fd = fd;
+			next[nnext].bytes = bytes;
+			nnext++;
+		}
+		free(runs);
+		runs = next;
+		nruns = nnext;
+		st->passes++;
+	}
+	if (!err) {
+		if (ext_merge(runs, nruns, out, ext_merge_cap(cfg, nruns)) < 0)
+			err = 1;
+		st->passes++;
+	}
+	for (i = 0; i < nruns; i++)
+		close(runs[i].fd);
+	free(runs);
+	close(out);
+	st->t_merge = now_sec() - t0;
+	
+	io_stop(&g_io);
+	if (g_io.error)
+		err = 1;
+	st->bytes_read = g_io.bytes_read;
+	st->bytes_written = g_io.bytes_written;
+	if (err)
+		fprintf(stderr, "外部排序失敗（記憶體不足、暫存目錄不能寫或磁碟滿了）\n");
+	return err ? -1 : 0;
+}
+
+// 與順序無關的檢查碼：每個元素雜湊後加總
+static inline uint64_t ext_checksum(const int x)
+{
+	return payload_of((uint64_t)(unsigned int) x);
+}
+
+// 產生 n 個全範圍的隨機 int（含負數），順便算檢查碼
+int ext_generate(const char *path, const long long n, const int seed, uint64_t *sum)
+{
+	Ext_Writer w;
+	long long i;
+	int fd, x, err;
+	
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || io_start(&g_io) != 0) {
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	err = ext_writer_open(&w, fd, 1 << 20) != 0;
+	*sum = 0;
+	srandom(seed);
+	for (i = 0; !err && i < n; i++) {
+		x = (int)(unsigned int) random_u64();
+		*sum += ext_checksum(x);
+		ext_writer_put(&w, x);
+	}
+	if (!err)
+		ext_writer_close(&w);
+	io_stop(&g_io);
+	close(fd);
+	return err || g_io.error ? -1 : 0;
+}
+
+// 循序讀一遍，檢查是否遞增，並算元素個數與檢查碼
+int ext_verify(const char *path, long long *n, uint64_t *sum)
+{
+	Ext_Reader r;
+	struct stat sb;
+	long long x, prev;
+	int fd, sorted;
+	
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &sb) != 0 || io_start(&g_io) != 0) {
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	sorted = 1;
+	*n = 0;
+	*sum = 0;
+	if (ext_reader_open(&r, fd, 0, sb.st_size, 1 << 20) == 0) {
+		prev = LLONG_MIN;
+		while ((x = ext_reader_get(&r)) != LLONG_MAX) {
+			if (x < prev)
+				sorted = 0;
+			prev = x;
+			(*n)++;
+			*sum += ext_checksum((int) x);
+		}
+		ext_reader_close(&r);
+	} else {
+		sorted = -1;
+	}
+	io_stop(&g_io);
+	close(fd);
+	return sorted;
+}
+
+void ext_report(const Ext_Stats *st, const Ext_Config *cfg)
+{
+	double mb, total;
+	
+	mb = 1024.0 * 1024.0;
+	total = st->t_runs + st->t_merge;
+	printf("資料 %.1f MB（%lld 個 int），記憶體預算 %.0f MB，暫存目錄 %s\n",
+	       st->n * sizeof(int) / mb, st->n, cfg->mem / mb, cfg->tmpdir);
+	printf("-------------------------------------------------\n");
+	printf("產生段落  %4d 段          %8.3f 秒  %8.1f MB/s\n", st->runs, st->t_runs,
+	       st->t_runs > 0 ? 2 * st->n * sizeof(int) / mb / st->t_runs : 0);
+	printf("合併      %4d 趟 (fan-in %d) %6.3f 秒  %8.1f MB/s\n", st->passes, st->fan_in, st->t_merge,
+	       st->t_merge > 0 ? 2.0 * st->passes * st->n * sizeof(int) / mb / st->t_merge : 0);
+	printf("-------------------------------------------------\n");
+	printf("I/O：讀 %.1f MB、寫 %.1f MB（資料量的 %.1f 倍），共 %.3f 秒，吞吐量 %.1f MB/s\n",
+	       st->bytes_read / mb, st->bytes_written / mb,
+	       st->n > 0 ? (double)(st->bytes_read + st->bytes_written) / (st->n * sizeof(int)) : 0,
+	       total, total > 0 ? (st->bytes_read + st->bytes_written) / mb / total : 0);
+}
+
+// 外部排序基準：在 tmpdir 產生 scale × mem 的資料（預設 4 倍，記憶體一定放不下），排序後驗證
+int ext_bench(const int scale, const Ext_Config *cfg)
+{
+	char in_path[4096], out_path[4096];
+	Ext_Stats st;
+	uint64_t sum_in, sum_out;
+	long long n, n_out;
+	double t0, t_gen;
+	int fd, sorted, bad;
+	
+	snprintf(in_path, sizeof(in_path), "%s/p2-ext-in-XXXXXX", cfg->tmpdir);
+	snprintf(out_path, sizeof(out_path), "%s/p2-ext-out-XXXXXX", cfg->tmpdir);
+	fd = mkstemp(in_path);
+	if (fd < 0) {
+		fprintf(stderr, "無法在 %s 建立暫存檔\n", cfg->tmpdir);
+		return 1;
+	}
+	close(fd);
+	fd = mkstemp(out_path);
+	if (fd < 0) {
+		fprintf(stderr, "無法在 %s 建立暫存檔\n", cfg->tmpdir);
+		unlink(in_path);
+		return 1;
+	}
+	close(fd);
+	
+	n = (long long) scale * cfg->mem / sizeof(int);
+	t0 = now_sec();
+	bad = ext_generate(in_path, n, 1, &sum_in) != 0;
+	t_gen = now_sec() - t0;
+	if (!bad) {
+		// 把輸入趕出 page cache，排序時才是真的從磁碟讀（暫存段還是可能留在快取裡）
+		fd = open(in_path, O_RDONLY);
+		if (fd >= 0) {
+			fdatasync(fd);
+#ifdef POSIX_FADV_DONTNEED
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+			close(fd);
+		}
+		printf("外部排序基準：%d × 記憶體預算，產生輸入 %.3f 秒\n", scale, t_gen);
+		bad = ext_sort_file(in_path, out_path, cfg, &st) != 0;
+	}
+	if (!bad) {
+		ext_report(&st, cfg);
+		sorted = ext_verify(out_path, &n_out, &sum_out);
+		bad = sorted != 1 || n_out != n || sum_out != sum_in;
+		printf("驗證：%s、%s、檢查碼%s\n", sorted == 1 ? "已排序" : "未排序",
+		       n_out == n ? "個數相符" : "個數不符", sum_out == sum_in ? "一致" : "不一致");
+	}
+	unlink(in_path);
+	unlink(out_path);
+	return bad;
+}
+
+// --ext-gen / --ext-sort / --ext-bench 的進入點
+int ext_main(int ac, char *av[])
+{
+	Ext_Config cfg;
+	Ext_Stats st;
+	char *pos[3];
+	uint64_t sum;
+	long long n;
+	int i, npos, mb;
+	
+	cfg.mem = (size_t) EXT_MEM_MB << 20;
+	cfg.tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+	npos = 0;
+	for (i = 2; i < ac; i++) {
+		if (strncmp(av[i], "--mem=", 6) == 0 && (mb = atoi(av[i] + 6)) > 0)
+			cfg.mem = (size_t) mb << 20;
+		else if (strncmp(av[i], "--tmpdir=", 9) == 0 && av[i][9])
+			cfg.tmpdir = av[i] + 9;
+		else if (av[i][0] != '-' && npos < 3)
+			pos[npos++] = av[i];
+		else
+			npos = -100;	// 看不懂的參數，底下印用法
+	}
+	
+	if (strcmp(av[1], "--ext-gen") == 0 && npos >= 2) {
+		n = atoll(pos[1]);
+		if (ext_generate(pos[0], n, npos > 2 ? atoi(pos[2]) : 1, &sum) != 0) {
+			fprintf(stderr, "無法寫入 %s\n", pos[0]);
+			return 1;
+		}
+		printf("產生 %lld 個 int 到 %s\n", n, pos[0]);
+		return 0;
+	}
+	if (strcmp(av[1], "--ext-sort") == 0 && npos == 2) {
+		if (ext_sort_file(pos[0], pos[1], &cfg, &st) != 0)
+			return 1;
+		ext_report(&st, &cfg);
+		return 0;
+	}
+	if (strcmp(av[1], "--ext-bench") == 0 && npos >= 0 && npos <= 1)
+		return ext_bench(npos == 1 && atoi(pos[0]) > 0 ? atoi(pos[0]) : 4, &cfg);
+	
+	fprintf(stderr, "用法：%s --ext-gen 檔案 n [seed]\n"
+	        "      %s --ext-sort 輸入 輸出 [--mem=MB] [--tmpdir=目錄]\n"
+	        "      %s --ext-bench [倍數] [--mem=MB] [--tmpdir=目錄]\n", av[0], av[0], av[0]);
+	return 2;
+}
+
+// ============================================================
+// 主程式
+// ============================================================
+
+void usage(const char *prog)
+{
+	fprintf(stderr, "用法：%s [n] [seed] [debug] [data_type] [演算法,...] [執行緒數] [鍵值範圍]\n"
+	        "          [--warmup=W] [--repeat=R] [--perf] [--format=text|csv|json] [--swaps=K]\n"
+	        "          [--sweep[=最小n:最大n:倍數]] [--budget=秒] [--algos=演算法,...]\n"
+	        "      %s --leaf [輪數]\n"
+	        "      %s --typed [n]\n"
+	        "      %s --ext-gen|--ext-sort|--ext-bench ...（外部排序）\n", prog, prog, prog, prog);
+}
+
+int main(int ac, char *av[])
+{
+	int *original, *temp;
+	int n, seed, debug, data_type;
+	const char *only;
+	Sort_Result results[NUM_ALGOS];
+	int i, nres, threads, warmup, repeat, use_perf, npos, sweep, rc;
+	char **pos;
+	Perf_Counters pc;
+	Run_Config cfg;
+	Sweep_Config sw;
+	
+	// 預設參數
+	n = 10000;
+	seed = 12345;
+	debug = 0;
+	data_type = 0;  // 0: 隨機, 1: 已排序, 2: 反向
+	only = NULL;    // 只跑哪些演算法，例如 "merge,merge_bu"
+	threads = 0;    // 平行排序的執行緒數，0 代表全部的 CPU
+	warmup = 0;     // 預設跟原本一樣只量一次
+	repeat = 1;
+	use_perf = 0;
+	sweep = 0;
+	sw.nmin = 1000;
+	sw.nmax = 1000000;
+	sw.factor = 2;
+	sw.budget = 1.0;
+	g_log = stdout;
+	
+	// 讀取命令列參數：-- 開頭的是選項，其餘照順序是 n seed debug data_type 演算法 執行緒數 鍵值範圍
+	if (ac > 1 && strcmp(av[1], "--leaf") == 0) {
+		i = ac > 2 ? atoi(av[2]) : 20;
+		return bench_leaf(i > 0 ? i : 1);
+	}
+	if (ac > 1 && strncmp(av[1], "--ext-", 6) == 0)
+		return ext_main(ac, av);
+	if (ac > 1 && strcmp(av[1], "--typed") == 0) {
+		i = ac > 2 ? atoi(av[2]) : 1 << 20;
+		return bench_typed(i > 0 ? i : 1);
+	}
+	pos = (char **) malloc(sizeof(char *) * ac);
+	if (pos == NULL) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	npos = 0;
+	for (i = 1; i < ac; i++) {
+		if (strncmp(av[i], "--", 2) != 0)
+			pos[npos++] = av[i];
+		else if (strncmp(av[i], "--warmup=", 9) == 0)
+			warmup = atoi(av[i] + 9);
+		else if (strncmp(av[i], "--repeat=", 9) == 0)
+			repeat = atoi(av[i] + 9);
+		else if (strcmp(av[i], "--perf") == 0)
+			use_perf = 1;
+		else if (strcmp(av[i], "--sweep") == 0)
+			sweep = 1;
+		else if (strncmp(av[i], "--sweep=", 8) == 0) {
+			sweep = 1;
+			sscanf(av[i] + 8, "%d:%d:%d", &sw.nmin, &sw.nmax, &sw.factor);
+		} else if (strncmp(av[i], "--budget=", 9) == 0)
+			sw.budget = atof(av[i] + 9);
+		else if (strncmp(av[i], "--algos=", 8) == 0)
+			only = av[i] + 8;
+		else if (strncmp(av[i], "--swaps=", 8) == 0)
+			near_swaps = atoi(av[i] + 8);
+		else if (strcmp(av[i], "--format=text") == 0)
+			out_format = FORMAT_TEXT;
+		else if (strcmp(av[i], "--format=csv") == 0)
+			out_format = FORMAT_CSV;
+		else if (strcmp(av[i], "--format=json") == 0)
+			out_format = FORMAT_JSON;
+		else {
+			usage(av[0]);
+			free(pos);
+			return 2;
+		}
+	}
+	if (npos > 0)
+		sscanf(pos[0], "%d", &n);
+	if (npos > 1)
+		sscanf(pos[1], "%d", &seed);
+	if (npos > 2)
+		sscanf(pos[2], "%d", &debug);
+	if (npos > 3)
+		sscanf(pos[3], "%d", &data_type);
+	if (npos > 4)
+		only = pos[4];
+	if (npos > 5)
+		sscanf(pos[5], "%d", &threads);
+	if (npos > 6)
+		sscanf(pos[6], "%d", &key_range);
+	free(pos);
+	if (only != NULL && !algo_list_valid(only)) {
+		usage(av[0]);
+		return 2;
+	}
+	if (key_range <= 0)
+		key_range = 100000;
+	if (threads <= 0)
+		threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (warmup < 0)
+		warmup = 0;
+	if (repeat < 1)
+		repeat = 1;
+	if (out_format != FORMAT_TEXT)
+		g_log = stderr;
+	if (sw.nmin < 1)
+		sw.nmin = 1;
+	if (sw.nmax < sw.nmin)
+		sw.nmax = sw.nmin;
+	if (sw.factor < 2)
+		sw.factor = 2;
+	if (sweep)
+		n = sw.nmax;
+	
+	fprintf(g_log, "=================================================\n");
+	fprintf(g_log, "排序演算法效能比較\n");
+	fprintf(g_log, "=================================================\n");
+	if (sweep) {
+		fprintf(g_log, "掃描: n = %d..%d（每次 ×%d），全部 %d 種資料類型\n", sw.nmin, sw.nmax, sw.factor, NUM_DATA_TYPES);
+		fprintf(g_log, "隨機種子: %d\n", seed);
+	} else {
+		fprintf(g_log, "資料量: n = %d\n", n);
+		fprintf(g_log, "隨機種子: %d\n", seed);
+		fprintf(g_log, "資料類型: %s", DATA_NAMES[data_type >= 0 && data_type < NUM_DATA_TYPES ? data_type : DATA_REVERSED]);
+		if (data_type == DATA_RANDOM || data_type == DATA_ZIPF)
+			fprintf(g_log, " [0, %d)", key_range);
+		fputc('\n', g_log);
+	}
+	
+	fprintf(g_log, "除錯模式: %s\n", debug ? "開啟" : "關閉");
+	fprintf(g_log, "執行緒數: %d\n", threads);
+	if (warmup > 0 || repeat > 1)
+		fprintf(g_log, "暖身 %d 次，計時 %d 次\n", warmup, repeat);
+	
+	pc.ok = 0;
+	if (use_perf && perf_open(&pc) < 0)
+		fprintf(g_log, "硬體計數器: 無法使用 perf_event_open（權限或虛擬機不支援），只報告時間\n");
+	else if (use_perf)
+		fprintf(g_log, "硬體計數器: cycles、instructions、branch misses、cache misses\n");
+	fprintf(g_log, "=================================================\n\n");
+	
+	cfg.n = n;
+	cfg.seed = seed;
+	cfg.data_type = data_type;
+	cfg.threads = threads;
+	cfg.key_range = key_range;
+	cfg.warmup = warmup;
+	cfg.repeat = repeat;
+	
+	if (sweep) {
+		if (pool_init(&g_pool, threads) < 0) {
+			fprintf(stderr, "記憶體配置失敗！\n");
+			return 1;
+		}
+		g_verbose = 0;
+		rc = run_sweep(&sw, &cfg, only, warmup, repeat, &pc);
+		perf_close(&pc);
+		pool_destroy(&g_pool);
+		return rc;
+	}
+	
+	// 配置記憶體
+	original = (int *) malloc(sizeof(int) * n);
+	temp = (int *) malloc(sizeof(int) * n);
+	
+	if (original == NULL || temp == NULL) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	
+	// 生成測試資料
+	generate_data(original, n, data_type, seed);
+	
+	// 除錯模式：印出部分資料
+	if (debug && n <= 100 && out_format == FORMAT_TEXT) {
+		printf("原始資料：\n");
+		print_array(original, n);
+		putchar('\n');
+	}
+	
+	if (pool_init(&g_pool, threads) < 0) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	
+	// 測試各個排序演算法：每次都從同一份原始資料開始
+	nres = 0;
+	for (i = 0; i < NUM_ALGOS; i++) {
+		if (!algo_selected(only, algos[i].id))
+			continue;
+		test_sort(&algos[i], original, temp, n, warmup, repeat, &pc, &results[nres]);
+		if (nres++ == 0 && debug && n <= 100 && out_format == FORMAT_TEXT) {
+			printf("排序後：\n");
+			print_array(temp, n);
+			putchar('\n');
+		}
+	}
+	perf_close(&pc);
+	
+	compute_speedups(results, nres);
+	
+	if (out_format != FORMAT_TEXT) {
+		i = 0;
+		write_records(stdout, &cfg, results, nres, &i);
+		finish_records(stdout, i);
+	} else {
+		// 印出結果摘要；量了不只一次時，時間是中位數
+		printf("\n=================================================\n");
+		printf("效能摘要 (n = %d)\n", n);
+		printf("=================================================\n");
+		if (repeat > 1) {
+			printf("%-15s %15s %10s %10s %10s\n", "演算法", "中位數(秒)", "最小(秒)", "標準差", "加速比");
+			printf("-------------------------------------------------------------------\n");
+		} else {
+			printf("%-15s %15s %10s\n", "演算法", "執行時間(秒)", "加速比");
+			printf("-------------------------------------------------\n");
+		}
+		
+		for (i = 0; i < nres; i++) {
+			printf("%-15s %15.4f", results[i].name, results[i].time);
+			if (repeat > 1)
+				printf(" %10.4f %10.4f", results[i].min, results[i].stddev);
+			if (results[i].speedup > 0)
+				printf(" %9.2fx\n", results[i].speedup);
+			else
+				printf(" %10s\n", "-");
+		}
+		
+		if (pc.ok || (nres > 0 && results[0].has_counters)) {
+			printf("-------------------------------------------------------------------\n");
+			printf("%-15s %14s %14s %12s %12s\n", "演算法", "cycles", "instructions", "br-miss", "cache-miss");
+			for (i = 0; i < nres; i++)
+				printf("%-15s %14lld %14lld %12lld %12lld\n", results[i].name, results[i].counters[0],
+				       results[i].counters[1], results[i].counters[2], results[i].counters[3]);
+		}
+		
+		printf("=================================================\n");
+	}
+	
+	// 釋放記憶體
+	pool_destroy(&g_pool);
+	free(original);
+	free(temp);
+	
+	return 0;
+}
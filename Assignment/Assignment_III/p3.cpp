@@ -7,6 +7,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// 位元平行 BFS 的 AVX2 版本只在 x86 + GCC/Clang 底下編進來，其他平台一律走 64 bits 的版本。
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define P3_X86_SIMD 1
+#else
+#define P3_X86_SIMD 0
+#endif
 
 // ============================================================
 // 資料結構定義
@@ -36,6 +46,85 @@ typedef struct {
 #define START 's'
 #define TARGET 't'
 
+// 線性索引：10^5 x 10^5 的迷宮超過 int 的範圍
+typedef int64_t Cell;
+
+// 迷宮：一整塊連續的格子，外面包一圈牆 (sentinel)。
+// 每列 stride 格（n + 2 補到 64 的倍數），每一列都從 64 格的邊界開始；格子 (r, c) 的線性索引是 r * stride + c，
+// 四個鄰居就是 -stride、+stride、-1、+1，走到邊界一定先撞到牆，不用檢查範圍。
+// packed 時只存「能不能走」，一格 1 bit（10^5 x 10^5 約 1.25 GB），起點與終點另外記在 start / target；
+// 否則一格一個字元 (EMPTY / OBSTACLE / START / TARGET)。
+typedef struct {
+	int m, n;
+	int stride;
+	int packed;
+	char *cell;		// packed == 0 時使用
+	uint64_t *wall;		// packed == 1 時使用，1 是牆或障礙物
+	Position start, target;
+} Grid;
+
+static inline size_t grid_cells(const Grid *g)
+{
+	return (size_t) (g->m + 2) * g->stride;
+}
+
+static inline Cell grid_index(const Grid *g, const int row, const int col)
+{
+	return (Cell) row * g->stride + col;
+}
+
+// 四個鄰居的線性索引差，順序是上、下、左、右，跟 bfs 的 dx / dy 一樣。
+// 每種 BFS 都照這個順序展開，2 bits 的 from 也是這個順序的編號；
+// 順序一改，找到的路徑（同樣長的最短路徑裡挑哪一條）就跟 bfs 不一樣了
+static inline void grid_offsets(const Grid *g, Cell off[4])
+{
+	off[0] = -g->stride;
+	off[1] = g->stride;
+	off[2] = -1;
+	off[3] = 1;
+}
+
+static inline Position grid_position(const Grid *g, const Cell idx)
+{
+	Position p;
+	
+	p.row = (int) (idx / g->stride);
+	p.col = (int) (idx % g->stride);
+	return p;
+}
+
+// 牆或障礙物
+static inline int grid_blocked(const Grid *g, const Cell idx)
+{
+	if (g->packed)
+		return (int) (g->wall[idx >> 6] >> (idx & 63) & 1);
+	return g->cell[idx] == OBSTACLE;
+}
+
+static inline char grid_get(const Grid *g, const Cell idx)
+{
+	if (!g->packed)
+		return g->cell[idx];
+	if (grid_blocked(g, idx))
+		return OBSTACLE;
+	if (idx == grid_index(g, g->start.row, g->start.col))
+		return START;
+	if (idx == grid_index(g, g->target.row, g->target.col))
+		return TARGET;
+	return EMPTY;
+}
+
+// packed 時 START / TARGET 只當成空地，位置由 read_maze 記在 start / target
+static inline void grid_set(Grid *g, const Cell idx, const char type)
+{
+	if (!g->packed)
+		g->cell[idx] = type;
+	else if (type == OBSTACLE)
+		g->wall[idx >> 6] |= 1ULL << (idx & 63);
+	else
+		g->wall[idx >> 6] &= ~(1ULL << (idx & 63));
+}
+
 // ============================================================
 // 佇列操作函數（自己實作）
 // ============================================================
@@ -104,60 +193,100 @@ void free_queue(Queue *q)
 // 迷宮操作函數
 // ============================================================
 
-// 讀取迷宮
-char **read_maze(int *m, int *n, Position *start, Position *target)
+// 配置 m x n 的格子，全部是空地，外圍一圈牆；失敗回傳 -1
+int grid_init(Grid *g, const int m, const int n, const int packed)
 {
-	char **maze;
-	int i, j, col;
+	size_t cells;
+	Cell i;
+	int r;
+	
+	g->m = m;
+	g->n = n;
+	g->stride = (n + 2 + 63) / 64 * 64;
+	g->packed = packed;
+	g->cell = NULL;
+	g->wall = NULL;
+	g->start.row = g->start.col = 0;
+	g->target.row = g->target.col = 0;
+	cells = grid_cells(g);
+	
+	if (packed) {
+		g->wall = (uint64_t *) calloc(cells / 64, sizeof(uint64_t));
+		if (g->wall == NULL)
+			return -1;
+	} else {
+		g->cell = (char *) malloc(cells);
+		if (g->cell == NULL)
+			return -1;
+		memset(g->cell, EMPTY, cells);
+	}
+	
+	// 第 0 列與第 m + 1 列整列是牆，每一列的第 0 行與第 n + 1 行以後也是牆
+	for (i = 0; i < g->stride; i++) {
+		grid_set(g, i, OBSTACLE);
+		grid_set(g, grid_index(g, m + 1, 0) + i, OBSTACLE);
+	}
+	for (r = 1; r <= m; r++) {
+		grid_set(g, grid_index(g, r, 0), OBSTACLE);
+		for (i = n + 1; i < g->stride; i++)
+			grid_set(g, grid_index(g, r, 0) + i, OBSTACLE);
+	}
+	return 0;
+}
+
+// 讀取迷宮；packed 非 0 時障礙物只用 1 bit 存。失敗回傳 -1
+int read_maze(Grid *g, const int packed)
+{
+	int m, n, i, col;
 	char type;
 	
 	// 讀取迷宮大小
-	scanf("%d %d", m, n);
+	if (scanf("%d %d", &m, &n) != 2 || m < 1 || n < 1)
+		return -1;
 	
 	// 配置記憶體
-	maze = (char **) malloc(sizeof(char *) * (*m + 1));
-	for (i = 0; i <= *m; i++) {
-		maze[i] = (char *) malloc(sizeof(char) * (*n + 1));
-		for (j = 0; j <= *n; j++)
-			maze[i][j] = EMPTY;
-	}
+	if (grid_init(g, m, n, packed) != 0)
+		return -1;
 	
 	// 讀取每一列的非空格子
-	for (i = 1; i <= *m; i++) {
+	for (i = 1; i <= m; i++) {
 		while (1) {
-			scanf("%d", &col);
-			if (col == 0)
+			if (scanf("%d", &col) != 1 || col == 0)
 				break;
 			
 			scanf(" %c", &type);
-			maze[i][col] = type;
+			if (col < 1 || col > n)
+				continue;
+			grid_set(g, grid_index(g, i, col), type);
 			
 			if (type == START) {
-				start->row = i;
-				start->col = col;
+				g->start.row = i;
+				g->start.col = col;
 			}
 			if (type == TARGET) {
-				target->row = i;
-				target->col = col;
+				g->target.row = i;
+				g->target.col = col;
 			}
 		}
 	}
 	
-	return maze;
+	return 0;
 }
 
 // 印出迷宮（除錯用）
-void print_maze(char **maze, const int m, const int n)
+void print_maze(const Grid *g)
 {
 	int i, j;
+	char c;
 	
 	printf("\n迷宮內容:\n");
-	for (i = 1; i <= m; i++) {
-		for (j = 1; j <= n; j++) {
-			if (maze[i][j] == EMPTY)
+	for (i = 1; i <= g->m; i++) {
+		for (j = 1; j <= g->n; j++) {
+			c = grid_get(g, grid_index(g, i, j));
+			if (c == EMPTY)
 				printf("  . ");
 			else
-				printf("  %c ", maze[i][j]);
+				printf("  %c ", c);
 		}
 		putchar('\n');
 	}
@@ -165,23 +294,23 @@ void print_maze(char **maze, const int m, const int n)
 }
 
 // 釋放迷宮記憶體
-void free_maze(char **maze, const int m)
+void free_maze(Grid *g)
 {
-	int i;
-	
-	for (i = 0; i <= m; i++)
-		free(maze[i]);
-	free(maze);
+	free(g->cell);
+	free(g->wall);
+	g->cell = NULL;
+	g->wall = NULL;
 }
 
 // ============================================================
 // BFS 最短路徑演算法
 // ============================================================
 
-int bfs(char **maze, const int m, const int n, 
-        const Position start, const Position target,
+// 原本的版本：串列佇列、int ** 的 visited，保留下來當效能測試的對照組
+int bfs(const Grid *g, const Position start, const Position target,
         Position **parent)
 {
+	const int m = g->m, n = g->n;
 	Queue *q;
 	int **visited;
 	Position current, next;
@@ -230,7 +359,7 @@ int bfs(char **maze, const int m, const int n,
 				continue;
 			
 			// 檢查是否可通行且未訪問
-			if (maze[next.row][next.col] != OBSTACLE && 
+			if (!grid_blocked(g, grid_index(g, next.row, next.col)) && 
 			    !visited[next.row][next.col]) {
 				visited[next.row][next.col] = 1;
 				(*parent)[next.row * (n + 1) + next.col] = current;
@@ -301,36 +430,37 @@ void print_path(const Position *path, const int count)
 	putchar('\n');
 }
 
-void print_maze_with_path(char **maze, const int m, const int n,
-                          const Position *path, const int count)
+void print_maze_with_path(const Grid *g, const Position *path, const int count)
 {
-	int **dist;
+	int *dist;
 	int i, j, k;
+	size_t c;
+	char type;
 	
-	// 配置距離陣列
-	dist = (int **) malloc(sizeof(int *) * (m + 1));
-	for (i = 0; i <= m; i++) {
-		dist[i] = (int *) malloc(sizeof(int) * (n + 1));
-		for (j = 0; j <= n; j++)
-			dist[i][j] = -1;
-	}
+	// 配置距離陣列，跟迷宮一樣用線性索引
+	dist = (int *) malloc(sizeof(int) * grid_cells(g));
+	if (dist == NULL)
+		return;
+	for (c = 0; c < grid_cells(g); c++)
+		dist[c] = -1;
 	
 	// 標記路徑上的距離
 	for (k = 0; k < count; k++)
-		dist[path[k].row][path[k].col] = k;
+		dist[grid_index(g, path[k].row, path[k].col)] = k;
 	
 	// 印出視覺化迷宮
 	printf("\n視覺化路徑（數字表示步數）:\n");
-	for (i = 1; i <= m; i++) {
-		for (j = 1; j <= n; j++) {
-			if (maze[i][j] == START)
+	for (i = 1; i <= g->m; i++) {
+		for (j = 1; j <= g->n; j++) {
+			type = grid_get(g, grid_index(g, i, j));
+			if (type == START)
 				printf("  s ");
-			else if (maze[i][j] == TARGET)
+			else if (type == TARGET)
 				printf("  t ");
-			else if (maze[i][j] == OBSTACLE)
+			else if (type == OBSTACLE)
 				printf("  x ");
-			else if (dist[i][j] >= 0)
-				printf("%3d ", dist[i][j]);
+			else if (dist[grid_index(g, i, j)] >= 0)
+				printf("%3d ", dist[grid_index(g, i, j)]);
 			else
 				printf("  . ");
 		}
@@ -339,22 +469,1040 @@ void print_maze_with_path(char **maze, const int m, const int n,
 	putchar('\n');
 	
 	// 釋放記憶體
-	for (i = 0; i <= m; i++)
-		free(dist[i]);
 	free(dist);
 }
 
+// ============================================================
+// 平坦陣列 BFS
+// ============================================================
+// 直接在 Grid 上走：鄰居是 -stride、+stride、-1、+1，外圍有牆，不用檢查範圍。
+// seen 一格 1 bit：牆與障礙物一開始就設成 1，所以「能不能走」跟「走過沒」只要看一個 bit；
+// 因為 stride 是 64 的倍數，packed 的迷宮可以整塊複製過來當 seen 的初值。
+// from 一格 2 bits，只記從哪個方向走進來，回溯時反著走就好；
+// 佇列是預先配置的環狀緩衝區，存線性索引，滿了才加倍，不再每個格子 malloc / free 一次。
+// 鄰居的順序跟 bfs 一樣（上下左右），所以找到的路徑也一模一樣。
+
+// 2 bits 的方向：grid_offsets 的編號（0 上、1 下、2 左、3 右）
+static inline void set_from(unsigned char from[], const Cell idx, const int d)
+{
+	int shift = (int) (idx & 3) * 2;
+	
+	from[idx >> 2] = (unsigned char) ((from[idx >> 2] & ~(3 << shift)) | (d << shift));
+}
+
+static inline int get_from(const unsigned char from[], const Cell idx)
+{
+	return (from[idx >> 2] >> ((idx & 3) * 2)) & 3;
+}
+
+// from 陣列的大小 (bytes)
+static inline size_t from_bytes(const Grid *g)
+{
+	return (grid_cells(g) + 3) / 4;
+}
+
+// 佇列滿了：容量加倍，順便把繞回開頭的那段接到後面，head 歸零
+int ring_grow(Cell **q, size_t *cap, size_t *head, size_t *tail)
+{
+	Cell *nq;
+	size_t i, n;
+	
+	nq = (Cell *) malloc(sizeof(Cell) * *cap * 2);
+	if (nq == NULL)
+		return -1;
+	n = *tail - *head;
+	for (i = 0; i < n; i++)
+		nq[i] = (*q)[(*head + i) & (*cap - 1)];
+	free(*q);
+	*q = nq;
+	*cap *= 2;
+	*head = 0;
+	*tail = n;
+	return 0;
+}
+
+// 牆與障礙物設成 1 的 bitmap，給各種 BFS 當 seen 的初值；失敗回傳 NULL
+uint64_t *blocked_bits(const Grid *g)
+{
+	uint64_t *bits, w;
+	size_t words, i;
+	int b;
+	
+	words = grid_cells(g) / 64;
+	bits = (uint64_t *) malloc(sizeof(uint64_t) * words);
+	if (bits == NULL)
+		return NULL;
+	if (g->packed) {
+		memcpy(bits, g->wall, sizeof(uint64_t) * words);
+		return bits;
+	}
+	for (i = 0; i < words; i++) {
+		w = 0;
+		for (b = 0; b < 64; b++)
+			w |= (uint64_t) (g->cell[i * 64 + b] == OBSTACLE) << b;
+		bits[i] = w;
+	}
+	return bits;
+}
+
+// from 要有 from_bytes(g) bytes，由呼叫者配置，不用清（只會讀走過的格子）。
+// 回傳 1 找到、0 找不到、-1 記憶體不足；visited_cells 是放進佇列的格子數
+int bfs_flat(const Grid *g, const Position start, const Position target,
+             unsigned char from[], long long *visited_cells)
+{
+	uint64_t *seen;
+	Cell *q;
+	size_t cap, head, tail;
+	Cell off[4];
+	Cell s, t, cur, nb;
+	int d, found;
+	
+	grid_offsets(g, off);
+	s = grid_index(g, start.row, start.col);
+	t = grid_index(g, target.row, target.col);
+	*visited_cells = 0;
+	if (grid_blocked(g, s) || grid_blocked(g, t))
+		return 0;	// 沒有起點或終點（還是 (0,0) 的牆）
+	
+	cap = 1024;
+	while (cap < 4 * ((size_t) g->m + g->n))
+		cap *= 2;
+	seen = blocked_bits(g);
+	q = (Cell *) malloc(sizeof(Cell) * cap);
+	if (seen == NULL || q == NULL) {
+		free(seen);
+		free(q);
+		return -1;
+	}
+	
+	head = tail = 0;
+	q[tail++] = s;
+	seen[s >> 6] |= 1ULL << (s & 63);
+	*visited_cells = 1;
+	found = 0;
+	
+	while (head != tail) {
+		cur = q[head++ & (cap - 1)];
+		if (cur == t) {
+			found = 1;
+			break;
+		}
+		for (d = 0; d < 4; d++) {
+			nb = cur + off[d];
+			if (seen[nb >> 6] >> (nb & 63) & 1)
+				continue;
+			seen[nb >> 6] |= 1ULL << (nb & 63);
+			set_from(from, nb, d);
+			if (tail - head == cap && ring_grow(&q, &cap, &head, &tail) != 0) {
+				found = -1;
+				break;
+			}
+			q[tail++ & (cap - 1)] = nb;
+			(*visited_cells)++;
+		}
+		if (found < 0)
+			break;
+	}
+	
+	free(seen);
+	free(q);
+	return found;
+}
+
+// 照 from 從終點反著走回起點，產生跟 reconstruct_path 一樣的路徑陣列
+int flat_path(const Grid *g, const unsigned char from[],
+              const Position start, const Position target, Position **path)
+{
+	Cell off[4];
+	Cell s, cur;
+	int count, i;
+	
+	grid_offsets(g, off);
+	s = grid_index(g, start.row, start.col);
+	
+	count = 1;
+	for (cur = grid_index(g, target.row, target.col); cur != s; cur -= off[get_from(from, cur)])
+		count++;
+	
+	*path = (Position *) malloc(sizeof(Position) * count);
+	cur = grid_index(g, target.row, target.col);
+	for (i = count - 1; i > 0; i--) {
+		(*path)[i] = grid_position(g, cur);
+		cur -= off[get_from(from, cur)];
+	}
+	(*path)[0] = start;
+	
+	return count;
+}
+
+// ============================================================
+// 雙向 BFS
+// ============================================================
+// 從起點與終點同時往外擴散，每次挑目前邊界 (frontier) 比較小的一邊，把它整層展開；
+// 某一邊碰到另一邊已經走過的格子就停。第一次碰到時兩邊都是完整的層，
+// 所以路徑長度 = 這邊的層數 + 1 + 另一邊的層數，一定是最短的。
+// 兩邊各有自己的 seen 與 2 bits 的 from；路徑 = 起點那棵樹回溯到相遇點，再接上終點那棵樹往終點走。
+// 另外一個好處：終點被圍住走不到時，小的那一邊很快就走完，不必把起點能到的地方全走一遍。
+
+typedef struct {
+	uint64_t *seen;
+	unsigned char *from;
+	Cell *q;
+	size_t cap, head, tail;
+} Bidir_Side;
+
+int bidir_side_init(Bidir_Side *b, const Grid *g, const Cell root)
+{
+	b->cap = 1024;
+	while (b->cap < 4 * ((size_t) g->m + g->n))
+		b->cap *= 2;
+	b->seen = blocked_bits(g);
+	b->from = (unsigned char *) malloc(from_bytes(g));
+	b->q = (Cell *) malloc(sizeof(Cell) * b->cap);
+	if (b->seen == NULL || b->from == NULL || b->q == NULL)
+		return -1;
+	b->head = 0;
+	b->tail = 1;
+	b->q[0] = root;
+	b->seen[root >> 6] |= 1ULL << (root & 63);
+	return 0;
+}
+
+void bidir_side_free(Bidir_Side *b)
+{
+	free(b->seen);
+	free(b->from);
+	free(b->q);
+}
+
+// 把 a 的目前這一層整層展開；碰到 o 走過的格子時，*meet_a 是 a 這邊的格子、*meet_o 是 o 那邊的格子。
+// 回傳 1 相遇、0 沒有、-1 記憶體不足
+int bidir_expand(Bidir_Side *a, const Bidir_Side *o, const Cell off[],
+                 Cell *meet_a, Cell *meet_o, long long *visited_cells)
+{
+	size_t level_end;
+	Cell cur, nb;
+	int d;
+	
+	level_end = a->tail;
+	while (a->head != level_end) {
+		cur = a->q[a->head++ & (a->cap - 1)];
+		for (d = 0; d < 4; d++) {
+			nb = cur + off[d];
+			if (a->seen[nb >> 6] >> (nb & 63) & 1)
+				continue;	// 牆、障礙物或自己走過
+			if (o->seen[nb >> 6] >> (nb & 63) & 1) {
+				*meet_a = cur;
+				*meet_o = nb;
+				return 1;
+			}
+			a->seen[nb >> 6] |= 1ULL << (nb & 63);
+			set_from(a->from, nb, d);
+			if (a->tail - a->head == a->cap) {
+				level_end -= a->head;	// ring_grow 會把 head 移到 0
+				if (ring_grow(&a->q, &a->cap, &a->head, &a->tail) != 0)
+					return -1;
+			}
+			a->q[a->tail++ & (a->cap - 1)] = nb;
+			(*visited_cells)++;
+		}
+	}
+	return 0;
+}
+
+// 回傳 1 找到（*path 與 *count 是完整路徑）、0 找不到、-1 記憶體不足
+int bfs_bidir(const Grid *g, const Position start, const Position target,
+              Position **path, int *count, long long *visited_cells)
+{
+	Bidir_Side side[2];	// 0 從起點、1 從終點
+	Cell off[4];
+	Cell s, t, ms, mt, cur;
+	int a, r, len_s, len_t, i;
+	
+	grid_offsets(g, off);
+	s = grid_index(g, start.row, start.col);
+	t = grid_index(g, target.row, target.col);
+	*visited_cells = 0;
+	if (grid_blocked(g, s) || grid_blocked(g, t))
+		return 0;
+	*visited_cells = 1;
+	
+	if (s == t) {
+		*path = (Position *) malloc(sizeof(Position));
+		(*path)[0] = start;
+		*count = 1;
+		return 1;
+	}
+	
+	memset(side, 0, sizeof(side));
+	r = -1;
+	if (bidir_side_init(&side[0], g, s) == 0 && bidir_side_init(&side[1], g, t) == 0) {
+		(*visited_cells)++;
+		r = 0;
+		ms = mt = 0;
+		// 兩邊都還有格子可以展開才繼續；挑邊界小的那邊
+		while (side[0].head != side[0].tail && side[1].head != side[1].tail) {
+			a = side[0].tail - side[0].head <= side[1].tail - side[1].head ? 0 : 1;
+			r = bidir_expand(&side[a], &side[a ^ 1], off, a == 0 ? &ms : &mt,
+			                 a == 0 ? &mt : &ms, visited_cells);
+			if (r != 0)
+				break;
+		}
+	}
+	
+	if (r == 1) {
+		// 起點樹：ms 回溯到 s；終點樹：mt 往 t 走
+		len_s = 0;
+		for (cur = ms; cur != s; cur -= off[get_from(side[0].from, cur)])
+			len_s++;
+		len_t = 0;
+		for (cur = mt; cur != t; cur -= off[get_from(side[1].from, cur)])
+			len_t++;
+		*count = len_s + 1 + len_t + 1;
+		*path = (Position *) malloc(sizeof(Position) * *count);
+		cur = ms;
+		for (i = len_s; i >= 0; i--) {
+			(*path)[i] = grid_position(g, cur);
+			if (i > 0)
+				cur -= off[get_from(side[0].from, cur)];
+		}
+		cur = mt;
+		for (i = len_s + 1; i < *count; i++) {
+			(*path)[i] = grid_position(g, cur);
+			if (i < *count - 1)
+				cur -= off[get_from(side[1].from, cur)];
+		}
+	}
+	
+	bidir_side_free(&side[0]);
+	bidir_side_free(&side[1]);
+	return r;
+}
+
+// ============================================================
+// 位元平行 BFS
+// ============================================================
+// 每列是連續的 stride / 64 個 uint64_t，所以一層的擴散可以 64 格一起做：
+//   next = (F << 1 | F >> 1 | F 的上一列 | F 的下一列) & ~visited
+// visited 的初值是 blocked_bits（牆與障礙物當成走過了），所以不用另外 & free。
+// 跨字組的進位直接讀隔壁的字組：每列頭尾都是牆，F 在那裡一定是 0，不會把別列的格子帶過來。
+// 每層只處理 frontier 所在的列與字組範圍（上下各多一列、左右各多一個字組），空的地方不碰；
+// 有 AVX2 時一次做 4 個字組。
+//
+// 路徑要跟 bfs 一模一樣：bfs 的佇列順序就是「從起點走過來的方向字串」的字典序（上 < 下 < 左 < 右），
+// 所以它找到的是所有最短路徑裡，從起點開始一步一步比方向、字典序最小的那一條。
+// 因此這裡反過來從終點往外擴散，用三個 bitset 記每格到終點的距離 mod 3，擴散到起點為止；
+// 再從起點出發，每一步照上下左右的順序挑第一個「到終點距離少 1」的鄰居，走出來的就是 bfs 那條路。
+// 相鄰格子的距離最多差 1，mod 3 就分得出來。
+
+// 有 frontier 的列，以及每列的字組範圍 [lo, hi]（列內的字組編號）；lo > hi 表示這列是空的
+typedef struct {
+	int *row;
+	int nrow;
+	int *lo, *hi;
+} Bits_Rows;
+
+static inline void bits_rows_add(Bits_Rows *b, const int r, const int lo, const int hi)
+{
+	if (b->lo[r] > b->hi[r]) {
+		b->row[b->nrow++] = r;
+		b->lo[r] = lo;
+		b->hi[r] = hi;
+		return;
+	}
+	if (lo < b->lo[r])
+		b->lo[r] = lo;
+	if (hi > b->hi[r])
+		b->hi[r] = hi;
+}
+
+// 一個字組的 next：f 是目前的 frontier，wr 是每列的字組數
+static inline uint64_t bits_next(const uint64_t f[], const size_t w, const size_t wr, const uint64_t vis)
+{
+	return (f[w] << 1 | f[w - 1] >> 63 | f[w] >> 1 | f[w + 1] << 63 | f[w - wr] | f[w + wr]) & ~vis;
+}
+
+// 第 w 個字組新走到的格子寫進 nx、vis、lab；回傳新格子數，並更新有新格子的字組範圍
+static inline int bits_store(uint64_t nx[], uint64_t vis[], uint64_t lab[], const size_t w,
+                             const uint64_t x, const int col, int *first, int *last)
+{
+	nx[w] = x;
+	if (x == 0)
+		return 0;
+	vis[w] |= x;
+	lab[w] |= x;
+	if (*first < 0)
+		*first = col;
+	*last = col;
+	return __builtin_popcountll(x);
+}
+
+// 算出第 base 開始那一列、字組 [lo, hi] 的 next；回傳新走到的格子數
+long long bits_row(const uint64_t f[], uint64_t nx[], uint64_t vis[], uint64_t lab[],
+                   const size_t base, const size_t wr, const int lo, const int hi, int *first, int *last)
+{
+	long long cnt;
+	int w;
+	
+	cnt = 0;
+	for (w = lo; w <= hi; w++)
+		cnt += bits_store(nx, vis, lab, base + w, bits_next(f, base + w, wr, vis[base + w]), w, first, last);
+	return cnt;
+}
+
+#if P3_X86_SIMD
+// 一次 4 個字組；左右鄰居的進位用錯開一個字組的 loadu 拿到
+__attribute__((target("avx2,popcnt")))
+long long bits_row_avx2(const uint64_t f[], uint64_t nx[], uint64_t vis[], uint64_t lab[],
+                        const size_t base, const size_t wr, const int lo, const int hi, int *first, int *last)
+{
+	__m256i c, l, r, v, x;
+	long long cnt;
+	size_t p;
+	int w, i;
+	
+	cnt = 0;
+	for (w = lo; w + 3 <= hi; w += 4) {
+		p = base + w;
+		c = _mm256_loadu_si256((const __m256i *) (f + p));
+		l = _mm256_loadu_si256((const __m256i *) (f + p - 1));
+		r = _mm256_loadu_si256((const __m256i *) (f + p + 1));
+		x = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(c, 1), _mm256_srli_epi64(l, 63)),
+		                    _mm256_or_si256(_mm256_srli_epi64(c, 1), _mm256_slli_epi64(r, 63)));
+		x = _mm256_or_si256(x, _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (f + p - wr)),
+		                                       _mm256_loadu_si256((const __m256i *) (f + p + wr))));
+		v = _mm256_loadu_si256((const __m256i *) (vis + p));
+		x = _mm256_andnot_si256(v, x);
+		_mm256_storeu_si256((__m256i *) (nx + p), x);
+		if (_mm256_testz_si256(x, x))
+			continue;
+		_mm256_storeu_si256((__m256i *) (vis + p), _mm256_or_si256(v, x));
+		for (i = 0; i < 4; i++)
+			cnt += bits_store(nx, vis, lab, p + i, nx[p + i], w + i, first, last);
+	}
+	for (; w <= hi; w++)
+		cnt += bits_store(nx, vis, lab, base + w, bits_next(f, base + w, wr, vis[base + w]), w, first, last);
+	return cnt;
+}
+#endif
+
+int has_avx2(void)
+{
+	static int avx2 = -1;
+	
+	if (avx2 < 0) {
+		avx2 = 0;
+#if P3_X86_SIMD
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	}
+	return avx2;
+}
+
+// 從 t 一層一層往外擴散到走到 s 為止；lab[d % 3] 記到 t 距離為 d 的格子。
+// vis 的初值是 blocked_bits，cur / nxt / lab 要是全 0，rows 要有 6 * (m + 2) 個 int。
+// 回傳 s 到 t 的距離，走不到回傳 -1
+int bits_spread(const Grid *g, const Cell s, const Cell t, uint64_t vis[], uint64_t *cur, uint64_t *nxt,
+                uint64_t *lab[3], int rows[], long long *visited_cells)
+{
+	uint64_t *tmp;
+	Bits_Rows fr, nr, tr;
+	size_t wr, base;
+	int k, i, j, r, lo, hi, first, last, avx2;
+	
+	// 兩組列集合：lo 全部 1、hi 全部 0 表示空的
+	fr.row = rows;
+	fr.lo = rows + (g->m + 2);
+	fr.hi = rows + 2 * (g->m + 2);
+	nr.row = rows + 3 * (g->m + 2);
+	nr.lo = rows + 4 * (g->m + 2);
+	nr.hi = rows + 5 * (g->m + 2);
+	for (i = 0; i < g->m + 2; i++) {
+		fr.lo[i] = nr.lo[i] = 1;
+		fr.hi[i] = nr.hi[i] = 0;
+	}
+	fr.nrow = nr.nrow = 0;
+	
+	wr = g->stride / 64;
+	cur[t >> 6] = 1ULL << (t & 63);
+	vis[t >> 6] |= cur[t >> 6];
+	lab[0][t >> 6] |= cur[t >> 6];
+	bits_rows_add(&fr, (int) (t / g->stride), (int) (t % g->stride / 64), (int) (t % g->stride / 64));
+	*visited_cells = 1;
+	avx2 = has_avx2();
+	
+	k = 0;
+	while (!(lab[k % 3][s >> 6] >> (s & 63) & 1)) {
+		if (fr.nrow == 0)
+			return -1;
+		
+		// 候選範圍：frontier 每列的上、本、下三列；範圍最左邊的格子在字組的 bit 0 時才往左多一個字組，
+		// 右邊同理。每列頭尾都是牆，不會超出這一列
+		for (i = 0; i < fr.nrow; i++) {
+			r = fr.row[i];
+			base = (size_t) r * wr;
+			lo = fr.lo[r] - (int) (cur[base + fr.lo[r]] & 1);
+			hi = fr.hi[r] + (int) (cur[base + fr.hi[r]] >> 63);
+			if (r > 1)
+				bits_rows_add(&nr, r - 1, lo, hi);
+			bits_rows_add(&nr, r, lo, hi);
+			if (r < g->m)
+				bits_rows_add(&nr, r + 1, lo, hi);
+		}
+		
+		// 展開一層，順便把範圍縮到真的有新格子的字組，空的列拿掉
+		k++;
+		j = 0;
+		for (i = 0; i < nr.nrow; i++) {
+			r = nr.row[i];
+			base = (size_t) r * wr;
+			first = last = -1;
+#if P3_X86_SIMD
+			if (avx2)
+				*visited_cells += bits_row_avx2(cur, nxt, vis, lab[k % 3], base, wr,
+				                                nr.lo[r], nr.hi[r], &first, &last);
+			else
+#endif
+				*visited_cells += bits_row(cur, nxt, vis, lab[k % 3], base, wr,
+				                           nr.lo[r], nr.hi[r], &first, &last);
+			if (first < 0) {
+				// 寫進去的都是 0，不用清
+				nr.lo[r] = 1;
+				nr.hi[r] = 0;
+			} else {
+				nr.lo[r] = first;
+				nr.hi[r] = last;
+				nr.row[j++] = r;
+			}
+		}
+		nr.nrow = j;
+		
+		// 舊的 frontier 清成 0，下一層拿來當 nxt
+		for (i = 0; i < fr.nrow; i++) {
+			r = fr.row[i];
+			memset(cur + (size_t) r * wr + fr.lo[r], 0, sizeof(uint64_t) * (fr.hi[r] - fr.lo[r] + 1));
+			fr.lo[r] = 1;
+			fr.hi[r] = 0;
+		}
+		fr.nrow = 0;
+		tmp = cur;
+		cur = nxt;
+		nxt = tmp;
+		tr = fr;
+		fr = nr;
+		nr = tr;
+	}
+	return k;
+}
+
+// path 由函式配置。回傳 1 找到（*path 與 *count 是完整路徑）、0 找不到、-1 記憶體不足；
+// visited_cells 是從終點擴散時走到的格子數
+int bfs_bits(const Grid *g, const Position start, const Position target,
+             Position **path, int *count, long long *visited_cells)
+{
+	uint64_t *vis, *cur, *nxt, *lab[3];
+	int *rows;
+	size_t words;
+	Cell off[4], s, t, c;
+	int k, i, d, found;
+	
+	grid_offsets(g, off);
+	s = grid_index(g, start.row, start.col);
+	t = grid_index(g, target.row, target.col);
+	*visited_cells = 0;
+	if (grid_blocked(g, s) || grid_blocked(g, t))
+		return 0;
+	
+	words = grid_cells(g) / 64;
+	vis = blocked_bits(g);
+	cur = (uint64_t *) calloc(words, sizeof(uint64_t));
+	nxt = (uint64_t *) calloc(words, sizeof(uint64_t));
+	lab[0] = (uint64_t *) calloc(words, sizeof(uint64_t));
+	lab[1] = (uint64_t *) calloc(words, sizeof(uint64_t));
+	lab[2] = (uint64_t *) calloc(words, sizeof(uint64_t));
+	rows = (int *) malloc(sizeof(int) * 6 * (g->m + 2));
+	found = -1;
+	if (vis != NULL && cur != NULL && nxt != NULL && lab[0] != NULL && lab[1] != NULL &&
+	    lab[2] != NULL && rows != NULL) {
+		k = bits_spread(g, s, t, vis, cur, nxt, lab, rows, visited_cells);
+		found = k >= 0;
+	}
+	
+	if (found == 1) {
+		// 起點到終點的距離是 k；每一步挑上下左右第一個距離少 1 的鄰居
+		*count = k + 1;
+		*path = (Position *) malloc(sizeof(Position) * *count);
+		c = s;
+		(*path)[0] = start;
+		for (i = 1; i <= k; i++) {
+			for (d = 0; d < 4; d++)
+				if (lab[(k - i) % 3][(c + off[d]) >> 6] >> ((c + off[d]) & 63) & 1)
+					break;
+			c += off[d];
+			(*path)[i] = grid_position(g, c);
+		}
+	}
+	
+	free(vis);
+	free(cur);
+	free(nxt);
+	free(lab[0]);
+	free(lab[1]);
+	free(lab[2]);
+	free(rows);
+	return found;
+}
+
+// ============================================================
+// 效能測試
+// ============================================================
+// ./p3 --bench [m] [n] [障礙物百分比] [seed] [--packed] [--span=K] [--maze]
+// 隨機產生迷宮（起點在左上角、終點在右下角；--span=K 改成在中間相距 K 格），同一個迷宮分別用 bfs、bfs_flat、bfs_bidir、bfs_bits 找路，
+// 比較時間與走訪的格子數；bfs_flat 與 bfs_bits 的路徑要跟 bfs 一模一樣，bfs_bidir 只要一樣長而且走得通。
+// --maze 改用 DFS 挖出來的迷宮（走道寬一格），障礙物百分比變成拆掉幾 % 的牆。
+
+double now_sec(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 每格有 pct% 的機率是障礙物；起點在左上角、終點在右下角，
+// span > 0 時改成放在正中間那一列、左右相距 span 格。失敗回傳 -1
+int random_maze(Grid *g, const int m, const int n, const int pct, const unsigned int seed,
+                const int packed, const int span)
+{
+	int i, j;
+	
+	if (grid_init(g, m, n, packed) != 0)
+		return -1;
+	srand(seed);
+	for (i = 1; i <= m; i++)
+		for (j = 1; j <= n; j++)
+			if (rand() % 100 < pct)
+				grid_set(g, grid_index(g, i, j), OBSTACLE);
+	g->start.row = 1;
+	g->start.col = 1;
+	g->target.row = m;
+	g->target.col = n;
+	if (span > 0) {
+		g->start.row = g->target.row = (m + 1) / 2;
+		g->start.col = n / 2 - span / 2 > 1 ? n / 2 - span / 2 : 1;
+		g->target.col = g->start.col + span < n ? g->start.col + span : n;
+	}
+	grid_set(g, grid_index(g, g->start.row, g->start.col), START);
+	grid_set(g, grid_index(g, g->target.row, g->target.col), TARGET);
+	return 0;
+}
+
+// 像迷宮的地圖：奇數列、奇數行的格子是房間，其餘先全部是障礙物，用隨機 DFS 打通成一棵樹（只有一條路），
+// 再把房間之間的牆隨機拆掉 pct%，做出環路（最短路徑不只一條，正好拿來檢查各種 BFS 挑的路徑是否相同）。
+// DFS 不用堆疊：走進房間時用 set_from 記方向，退回時照著反方向走。起點在左上角、終點在右下角的房間
+int maze_like(Grid *g, const int m, const int n, const int pct, const unsigned int seed, const int packed)
+{
+	unsigned char *from;
+	Cell off[4], root, cur, nb;
+	Position p;
+	int dr[4] = {-2, 2, 0, 0};	// 上下左右，一次跳一個房間
+	int dc[4] = {0, 0, -2, 2};
+	int dirs[4];
+	int i, j, d, nd;
+	
+	if (grid_init(g, m, n, packed) != 0)
+		return -1;
+	from = (unsigned char *) malloc(from_bytes(g));
+	if (from == NULL) {
+		free_maze(g);
+		return -1;
+	}
+	grid_offsets(g, off);
+	srand(seed);
+	for (i = 1; i <= m; i++)
+		for (j = 1; j <= n; j++)
+			if (i % 2 == 0 || j % 2 == 0)
+				grid_set(g, grid_index(g, i, j), OBSTACLE);
+	
+	// 房間一開始是空地，走過就把它標成障礙物當作「走過了」，最後再改回空地
+	root = cur = grid_index(g, 1, 1);
+	grid_set(g, root, OBSTACLE);
+	for (;;) {
+		p = grid_position(g, cur);
+		nd = 0;
+		for (d = 0; d < 4; d++) {
+			if (p.row + dr[d] < 1 || p.row + dr[d] > m || p.col + dc[d] < 1 || p.col + dc[d] > n)
+				continue;
+			nb = cur + 2 * off[d];
+			if (!grid_blocked(g, nb))
+				dirs[nd++] = d;
+		}
+		if (nd > 0) {
+			d = dirs[rand() % nd];
+			grid_set(g, cur + off[d], EMPTY);
+			cur += 2 * off[d];
+			grid_set(g, cur, OBSTACLE);
+			set_from(from, cur, d);
+		} else if (cur == root) {
+			break;
+		} else {
+			cur -= 2 * off[get_from(from, cur)];
+		}
+	}
+	free(from);
+	for (i = 1; i <= m; i += 2)
+		for (j = 1; j <= n; j += 2)
+			grid_set(g, grid_index(g, i, j), EMPTY);
+	
+	// 拆牆：只拆夾在兩個房間中間的牆
+	for (i = 1; i <= m; i++)
+		for (j = 1; j <= n; j++)
+			if (((i % 2 == 0 && j % 2 == 1 && i < m) || (i % 2 == 1 && j % 2 == 0 && j < n)) &&
+			    rand() % 100 < pct)
+				grid_set(g, grid_index(g, i, j), EMPTY);
+	
+	g->start.row = 1;
+	g->start.col = 1;
+	g->target.row = m % 2 ? m : m - 1;
+	g->target.col = n % 2 ? n : n - 1;
+	grid_set(g, grid_index(g, g->start.row, g->start.col), START);
+	grid_set(g, grid_index(g, g->target.row, g->target.col), TARGET);
+	return 0;
+}
+
+// 路徑是否從 start 一步一格走到 target，而且不穿過障礙物
+int valid_path(const Grid *g, const Position *path, const int count, const Position start, const Position target)
+{
+	int i, dr, dc;
+	
+	if (count < 1 || path[0].row != start.row || path[0].col != start.col ||
+	    path[count - 1].row != target.row || path[count - 1].col != target.col)
+		return 0;
+	for (i = 0; i < count; i++) {
+		if (grid_blocked(g, grid_index(g, path[i].row, path[i].col)))
+			return 0;
+		if (i > 0) {
+			dr = path[i].row - path[i - 1].row;
+			dc = path[i].col - path[i - 1].col;
+			if (dr * dr + dc * dc != 1)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+int bench(const int m, const int n, const int pct, const int seed, const int packed, const int span,
+          const int maze)
+{
+	Grid g;
+	Position *parent, *path_list, *path_flat, *path_bidir, *path_bits;
+	unsigned char *from;
+	long long visited, visited_bidir, visited_bits;
+	int found_list, found_flat, found_bidir, found_bits, len_list, len_flat, len_bidir, len_bits;
+	int same, ok_bidir, same_bits;
+	double t0, t_list, t_flat, t_bidir, t_bits;
+	
+	if ((maze ? maze_like(&g, m, n, pct, seed, packed) : random_maze(&g, m, n, pct, seed, packed, span)) != 0) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	if (maze)
+		printf("迷宮 %d x %d（DFS 迷宮，拆掉 %d%% 的牆），seed %d，%s\n", m, n, pct, seed,
+		       packed ? "障礙物 1 bit / 格" : "一格一個字元");
+	else
+		printf("迷宮 %d x %d，障礙物 %d%%，seed %d，%s\n", m, n, pct, seed,
+		       packed ? "障礙物 1 bit / 格" : "一格一個字元");
+	printf("起點 (%d,%d)，終點 (%d,%d)\n", g.start.row, g.start.col, g.target.row, g.target.col);
+	
+	t0 = now_sec();
+	found_list = bfs(&g, g.start, g.target, &parent);
+	t_list = now_sec() - t0;
+	len_list = found_list ? reconstruct_path(parent, n, g.start, g.target, &path_list) : 0;
+	free(parent);
+	
+	from = (unsigned char *) malloc(from_bytes(&g));
+	t0 = now_sec();
+	found_flat = from ? bfs_flat(&g, g.start, g.target, from, &visited) : -1;
+	t_flat = now_sec() - t0;
+	t0 = now_sec();
+	found_bidir = bfs_bidir(&g, g.start, g.target, &path_bidir, &len_bidir, &visited_bidir);
+	t_bidir = now_sec() - t0;
+	t0 = now_sec();
+	found_bits = bfs_bits(&g, g.start, g.target, &path_bits, &len_bits, &visited_bits);
+	t_bits = now_sec() - t0;
+	if (found_flat < 0 || found_bidir < 0 || found_bits < 0) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+	len_flat = found_flat ? flat_path(&g, from, g.start, g.target, &path_flat) : 0;
+	if (!found_bidir)
+		len_bidir = 0;
+	if (!found_bits)
+		len_bits = 0;
+	
+	same = found_list == found_flat && len_list == len_flat;
+	if (same && found_flat)
+		same = memcmp(path_list, path_flat, sizeof(Position) * len_flat) == 0;
+	ok_bidir = found_bidir == found_flat && len_bidir == len_flat;
+	if (ok_bidir && found_bidir)
+		ok_bidir = valid_path(&g, path_bidir, len_bidir, g.start, g.target);
+	same_bits = found_bits == found_flat && len_bits == len_flat;
+	if (same_bits && found_bits)
+		same_bits = memcmp(path_bits, path_flat, sizeof(Position) * len_flat) == 0;
+	
+	printf("-------------------------------------------------------------\n");
+	printf("%-22s %10s %12s %14s\n", "method", "sec", "ns/cell", "visited");
+	printf("%-22s %10.4f %12.2f %14s\n", "bfs (linked queue)", t_list, t_list * 1e9 / ((double) m * n), "-");
+	printf("%-22s %10.4f %12.2f %14lld   %.1fx\n", "bfs_flat", t_flat, t_flat * 1e9 / ((double) m * n),
+	       visited, t_list / t_flat);
+	printf("%-22s %10.4f %12.2f %14lld   %.1fx\n", "bfs_bidir", t_bidir, t_bidir * 1e9 / ((double) m * n),
+	       visited_bidir, t_list / t_bidir);
+	printf("%-22s %10.4f %12.2f %14lld   %.1fx\n", has_avx2() ? "bfs_bits (avx2)" : "bfs_bits (64-bit)",
+	       t_bits, t_bits * 1e9 / ((double) m * n), visited_bits, t_list / t_bits);
+	printf("-------------------------------------------------------------\n");
+	if (found_flat)
+		printf("路徑長度 %d 步；bfs_flat 與 bfs 的路徑%s，bfs_bidir 的路徑%s，bfs_bits 的路徑%s\n", len_flat - 1,
+		       same ? "相同" : "不同！", ok_bidir ? "一樣長" : "有誤！", same_bits ? "相同" : "不同！");
+	else
+		printf("沒有路徑；bfs_flat %s，bfs_bidir %s，bfs_bits %s\n", same ? "一致" : "不一致！",
+		       ok_bidir ? "一致" : "不一致！", same_bits ? "一致" : "不一致！");
+	
+	if (found_list)
+		free(path_list);
+	if (found_flat)
+		free(path_flat);
+	if (found_bidir)
+		free(path_bidir);
+	if (found_bits)
+		free(path_bits);
+	free(from);
+	free_maze(&g);
+	return !same || !ok_bidir || !same_bits;
+}
+
+// ============================================================
+// 多次查詢
+// ============================================================
+// ./p3 --queries [--packed] < 迷宮與查詢
+// 迷宮只讀一次，後面每行一筆查詢 "r1 c1 r2 c2"（起點、終點），讀到檔尾為止；
+// 每筆輸出最短路徑的步數，走不到（或座標超出範圍、在障礙物上）輸出 -1，最後印出每秒幾筆查詢。
+// 所有緩衝區只配置一次，查詢之間重複使用：
+// - 走過沒用每格一個 uint16_t 的 stamp：這筆查詢的編號 gen 寫進去就算走過，下一筆把 gen 加 1，舊的標記自然失效，不用清。
+//   牆與障礙物的 stamp 是 STAMP_WALL，永遠 >= gen，所以「不能走或走過了」只要比一次 stamp >= gen。
+//   gen 用完（65534 筆）才整個重設一次；一格 2 bytes，比 uint32_t 省一半，重設的成本分攤下來也很小。
+// - from（2 bits 方向）只會讀這筆走過的格子，不用清；佇列不夠大時加倍，之後一直留著。
+
+#define STAMP_WALL 0xFFFF
+
+typedef struct {
+	const Grid *g;
+	uint16_t *stamp;
+	uint16_t gen;
+	unsigned char *from;
+	Cell *q;
+	size_t cap;
+	Cell off[4];
+} Query_Ctx;
+
+// 牆與障礙物設成 STAMP_WALL，其他歸零，gen 從頭開始
+void query_reset(Query_Ctx *c)
+{
+	size_t i, cells;
+	
+	cells = grid_cells(c->g);
+	for (i = 0; i < cells; i++)
+		c->stamp[i] = grid_blocked(c->g, (Cell) i) ? STAMP_WALL : 0;
+	c->gen = 0;
+}
+
+int query_init(Query_Ctx *c, const Grid *g)
+{
+	c->g = g;
+	c->cap = 1024;
+	while (c->cap < 4 * ((size_t) g->m + g->n))
+		c->cap *= 2;
+	c->stamp = (uint16_t *) malloc(sizeof(uint16_t) * grid_cells(g));
+	c->from = (unsigned char *) malloc(from_bytes(g));
+	c->q = (Cell *) malloc(sizeof(Cell) * c->cap);
+	if (c->stamp == NULL || c->from == NULL || c->q == NULL)
+		return -1;
+	grid_offsets(g, c->off);
+	query_reset(c);
+	return 0;
+}
+
+void query_free(Query_Ctx *c)
+{
+	free(c->stamp);
+	free(c->from);
+	free(c->q);
+}
+
+// 回傳 s 到 t 的步數、-1 走不到、-2 記憶體不足。
+// 找到時 c->from 從 t 回溯就是路徑（跟 bfs_flat 一樣），直到下一筆查詢為止
+int query_bfs(Query_Ctx *c, const Cell s, const Cell t)
+{
+	size_t head, tail, level_end;
+	Cell cur, nb;
+	int d, dist;
+	
+	if (c->stamp[s] == STAMP_WALL || c->stamp[t] == STAMP_WALL)
+		return -1;
+	if (s == t)
+		return 0;
+	if (c->gen == STAMP_WALL - 1)
+		query_reset(c);
+	c->gen++;
+	
+	head = tail = 0;
+	c->q[tail++] = s;
+	c->stamp[s] = c->gen;
+	for (dist = 1; head != tail; dist++) {
+		level_end = tail;
+		while (head != level_end) {
+			cur = c->q[head++ & (c->cap - 1)];
+			for (d = 0; d < 4; d++) {
+				nb = cur + c->off[d];
+				if (c->stamp[nb] >= c->gen)
+					continue;
+				c->stamp[nb] = c->gen;
+				set_from(c->from, nb, d);
+				if (nb == t)
+					return dist;
+				if (tail - head == c->cap) {
+					level_end -= head;	// ring_grow 會把 head 移到 0
+					if (ring_grow(&c->q, &c->cap, &head, &tail) != 0)
+						return -2;
+				}
+				c->q[tail++ & (c->cap - 1)] = nb;
+			}
+		}
+	}
+	return -1;
+}
+
+// 座標在迷宮裡面才算
+static inline int query_inside(const Grid *g, const int row, const int col)
+{
+	return row >= 1 && row <= g->m && col >= 1 && col <= g->n;
+}
+
+int serve_queries(const Grid *g)
+{
+	Query_Ctx c;
+	long long nq, found;
+	double t0, t_bfs, t_all;
+	int r1, c1, r2, c2, dist;
+	
+	if (query_init(&c, g) != 0) {
+		printf("記憶體配置失敗！\n");
+		query_free(&c);
+		return 1;
+	}
+	
+	nq = found = 0;
+	t_bfs = 0;
+	t_all = now_sec();
+	while (scanf("%d %d %d %d", &r1, &c1, &r2, &c2) == 4) {
+		t0 = now_sec();
+		dist = -1;
+		if (query_inside(g, r1, c1) && query_inside(g, r2, c2))
+			dist = query_bfs(&c, grid_index(g, r1, c1), grid_index(g, r2, c2));
+		t_bfs += now_sec() - t0;
+		if (dist == -2) {
+			printf("記憶體配置失敗！\n");
+			query_free(&c);
+			return 1;
+		}
+		printf("%d\n", dist);
+		nq++;
+		found += dist >= 0;
+	}
+	t_all = now_sec() - t_all;
+	
+	fprintf(stderr, "查詢 %lld 筆（找到 %lld 筆），BFS %.4f 秒，%.0f 筆/秒；含輸入輸出 %.4f 秒，%.0f 筆/秒\n",
+	        nq, found, t_bfs, t_bfs > 0 ? nq / t_bfs : 0, t_all, t_all > 0 ? nq / t_all : 0);
+	query_free(&c);
+	return 0;
+}
+
 // ============================================================
 // 主程式
 // ============================================================
 
+// BFS 的實作：flat 是平坦陣列版本（預設），list 是原本用串列佇列的 bfs，bidir 是雙向 BFS，
+// bits 是位元平行 BFS
+#define ENGINE_LIST 0
+#define ENGINE_FLAT 1
+#define ENGINE_BIDIR 2
+#define ENGINE_BITS 3
+
 int main(int ac, char *av[])
 {
-	char **maze;
-	int m, n;
-	Position start, target;
+	Grid g;
 	Position *parent, *path;
+	unsigned char *from;
+	char *pos[4];
+	long long visited;
 	int found, path_length;
+	int i, npos, debug, engine, packed, bench_mode, span, maze, queries;
+	
+	// 參數：--bfs=list|flat|bidir|bits 選 BFS 的實作，--packed 讓障礙物一格只佔 1 bit；
+	// 一般模式下任何不是選項的參數會打開除錯輸出，--bench 模式下依序是 m n 障礙物百分比 seed；
+	// --queries 讀完迷宮後接著讀一連串的查詢
+	debug = 0;
+	engine = ENGINE_FLAT;
+	packed = 0;
+	bench_mode = 0;
+	span = 0;
+	maze = 0;
+	queries = 0;
+	npos = 0;
+	for (i = 1; i < ac; i++) {
+		if (strcmp(av[i], "--bfs=list") == 0)
+			engine = ENGINE_LIST;
+		else if (strcmp(av[i], "--bfs=flat") == 0)
+			engine = ENGINE_FLAT;
+		else if (strcmp(av[i], "--bfs=bidir") == 0)
+			engine = ENGINE_BIDIR;
+		else if (strcmp(av[i], "--bfs=bits") == 0)
+			engine = ENGINE_BITS;
+		else if (strcmp(av[i], "--packed") == 0)
+			packed = 1;
+		else if (strcmp(av[i], "--bench") == 0)
+			bench_mode = 1;
+		else if (strncmp(av[i], "--span=", 7) == 0)
+			span = atoi(av[i] + 7);
+		else if (strcmp(av[i], "--maze") == 0)
+			maze = 1;
+		else if (strcmp(av[i], "--queries") == 0)
+			queries = 1;
+		else if (strncmp(av[i], "--", 2) == 0) {
+			fprintf(stderr, "用法：%s [--bfs=list|flat|bidir|bits] [--packed] [debug] < 迷宮\n"
+			        "      %s --bench [m] [n] [障礙物百分比] [seed] [--packed] [--span=K] [--maze]\n"
+			        "      %s --queries [--packed] < 迷宮與查詢 (每行 r1 c1 r2 c2)\n", av[0], av[0], av[0]);
+			return 2;
+		} else {
+			debug = 1;
+			if (npos < 4)
+				pos[npos++] = av[i];
+		}
+	}
+	if (bench_mode)
+		return bench(npos > 0 ? atoi(pos[0]) : 2000, npos > 1 ? atoi(pos[1]) : 2000,
+		             npos > 2 ? atoi(pos[2]) : 25, npos > 3 ? atoi(pos[3]) : 1, packed, span, maze);
+	
+	// 多次查詢：不印標題，每筆查詢只輸出一行步數
+	if (queries) {
+		if (read_maze(&g, packed) != 0) {
+			printf("迷宮格式錯誤或記憶體配置失敗！\n");
+			return 1;
+		}
+		i = serve_queries(&g);
+		free_maze(&g);
+		return i;
+	}
 	
 	printf("=================================================\n");
 	printf("迷宮最短路徑尋找程式\n");
@@ -362,29 +1510,59 @@ int main(int ac, char *av[])
 	printf("請輸入迷宮資料（格式：m n，然後每行的非空格子）\n\n");
 	
 	// 讀取迷宮
-	maze = read_maze(&m, &n, &start, &target);
+	if (read_maze(&g, packed) != 0) {
+		printf("迷宮格式錯誤或記憶體配置失敗！\n");
+		return 1;
+	}
 	
-	printf("迷宮大小: %d x %d\n", m, n);
-	printf("起點: (%d,%d)\n", start.row, start.col);
-	printf("終點: (%d,%d)\n", target.row, target.col);
+	printf("迷宮大小: %d x %d\n", g.m, g.n);
+	printf("起點: (%d,%d)\n", g.start.row, g.start.col);
+	printf("終點: (%d,%d)\n", g.target.row, g.target.col);
 	
 	// 除錯：印出迷宮
-	if (ac > 1)
-		print_maze(maze, m, n);
+	if (debug)
+		print_maze(&g);
 	
 	// 執行 BFS 尋找最短路徑
 	printf("\n開始搜尋最短路徑...\n");
-	found = bfs(maze, m, n, start, target, &parent);
+	parent = NULL;
+	from = NULL;
+	if (engine == ENGINE_FLAT) {
+		from = (unsigned char *) malloc(from_bytes(&g));
+		found = from ? bfs_flat(&g, g.start, g.target, from, &visited) : -1;
+		if (found < 0) {
+			printf("記憶體配置失敗！\n");
+			free(from);
+			free_maze(&g);
+			return 1;
+		}
+	} else if (engine == ENGINE_BIDIR || engine == ENGINE_BITS) {
+		if (engine == ENGINE_BIDIR)
+			found = bfs_bidir(&g, g.start, g.target, &path, &path_length, &visited);
+		else
+			found = bfs_bits(&g, g.start, g.target, &path, &path_length, &visited);
+		if (found < 0) {
+			printf("記憶體配置失敗！\n");
+			free_maze(&g);
+			return 1;
+		}
+	} else {
+		found = bfs(&g, g.start, g.target, &parent);
+	}
 	
 	if (!found) {
 		printf("\n無法找到從起點到終點的路徑！\n");
 		free(parent);
-		free_maze(maze, m);
+		free(from);
+		free_maze(&g);
 		return 1;
 	}
 	
-	// 重建路徑
-	path_length = reconstruct_path(parent, n, start, target, &path);
+	// 重建路徑（雙向 BFS 與位元平行 BFS 已經順便接好了）
+	if (engine == ENGINE_FLAT)
+		path_length = flat_path(&g, from, g.start, g.target, &path);
+	else if (engine == ENGINE_LIST)
+		path_length = reconstruct_path(parent, g.n, g.start, g.target, &path);
 	
 	printf("找到路徑！長度: %d 步\n\n", path_length - 1);
 	
@@ -392,14 +1570,15 @@ int main(int ac, char *av[])
 	print_path(path, path_length);
 	
 	// 視覺化顯示
-	print_maze_with_path(maze, m, n, path, path_length);
+	print_maze_with_path(&g, path, path_length);
 	
 	printf("=================================================\n");
 	
 	// 釋放記憶體
 	free(path);
 	free(parent);
-	free_maze(maze, m);
+	free(from);
+	free_maze(&g);
 	
 	return 0;
 }
@@ -0,0 +1,210 @@
+// date 函式庫效能測試：每個操作在隨機、連續、邊界三種輸入上的 ns/op
+// 作者：蔡秀吉 (H. C. Tsai)
+// 電子信箱：hctsai@linux
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "date.h"
+
+// ============================================================
+// 輔助函數
+// ============================================================
+
+#define NUM_SETS 3
+#define NUM_OPS 6
+
+static const char *SET_NAMES[NUM_SETS] = { "random", "sequential", "edge-case" };
+static const char *OP_NAMES[NUM_OPS] = {
+	"valid_date", "DateToSerial", "SerialToDate", "DateAdd", "DateSub", "DayOfWeek"
+};
+
+// 計時用單調時鐘，不受系統校時影響
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// xorshift64：固定種子，每次跑的輸入都一樣
+static uint64_t rng = 88172645463325252ULL;
+
+static uint64_t rng_next(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng;
+}
+
+static int days_in(const int y, const int m)
+{
+	static const int md[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+	return md[m - 1] + (m == 2 && is_leap(y));
+}
+
+// 1..9999 年之間均勻的合法日期
+static void fill_random(date a[], const int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		a[i].y = 1 + (int) (rng_next() % 9999);
+		a[i].m = 1 + (int) (rng_next() % 12);
+		a[i].d = 1 + (int) (rng_next() % (uint64_t) days_in(a[i].y, a[i].m));
+	}
+}
+
+// 從 2000/1/1 開始一天一天往後
+static void fill_sequential(date a[], const int n)
+{
+	date cur = {2000, 1, 1};
+	int i;
+
+	for (i = 0; i < n; i++) {
+		a[i] = cur;
+		if (cur.d < days_in(cur.y, cur.m)) {
+			cur.d++;
+		} else {
+			cur.d = 1;
+			if (++cur.m > 12) {
+				cur.m = 1;
+				cur.y++;
+			}
+		}
+	}
+}
+
+// 月底、閏日、跨年、世紀年、西元元年與西元前
+static void fill_edge(date a[], const int n)
+{
+	static const date edges[] = {
+		{2000, 2, 29}, {1900, 2, 28}, {2100, 2, 28}, {2024, 2, 29}, {2023, 2, 28},
+		{1999, 12, 31}, {2000, 1, 1}, {1, 1, 1}, {0, 12, 31}, {-1, 3, 1},
+		{-4713, 11, 24}, {9999, 12, 31}, {1582, 10, 15}, {2025, 4, 30}, {2025, 1, 31},
+		{1600, 2, 29}
+	};
+	const int ne = (int) (sizeof(edges) / sizeof(edges[0]));
+	int i;
+
+	for (i = 0; i < n; i++)
+		a[i] = edges[rng_next() % (uint64_t) ne];
+}
+
+// ============================================================
+// 效能測試函數
+// ============================================================
+
+// 回傳 ns/op；結果累加到 sink，避免整個迴圈被最佳化掉
+static double bench_op(const int op, const date a[], const int64_t j[], const int x[], const int n, uint64_t *sink)
+{
+	double start;
+	uint64_t acc = 0;
+	int i;
+
+	start = now_sec();
+	switch (op) {
+	case 0:
+		for (i = 0; i < n; i++)
+			acc += (uint64_t) valid_date(a[i]);
+		break;
+	case 1:
+		for (i = 0; i < n; i++)
+			acc += (uint64_t) DateToSerial(a[i]);
+		break;
+	case 2:
+		for (i = 0; i < n; i++)
+			acc += (uint64_t) SerialToDate(j[i]).d;
+		break;
+	case 3:
+		for (i = 0; i < n; i++)
+			acc += (uint64_t) DateAdd(a[i], x[i]).d;
+		break;
+	case 4:
+		for (i = 0; i + 1 < n; i++)
+			acc += (uint64_t) DateSub(a[i], a[i + 1]);
+		break;
+	default:
+		for (i = 0; i < n; i++)
+			acc += (uint64_t) (uintptr_t) DayOfWeek(a[i]);
+		break;
+	}
+	*sink += acc;
+	return (now_sec() - start) * 1e9 / n;
+}
+
+// ============================================================
+// 主程式
+// ============================================================
+
+int main(int ac, char *av[])
+{
+	date *a;
+	int64_t *j;
+	int *x;
+	int n, s, op, i;
+	double ns[NUM_SETS][NUM_OPS];
+	uint64_t sink = 0;
+
+	n = 1 << 20;
+	if (ac > 1)
+		sscanf(av[1], "%d", &n);
+	if (n < 2)
+		n = 2;
+
+	a = (date *) malloc(sizeof(date) * n);
+	j = (int64_t *) malloc(sizeof(int64_t) * n);
+	x = (int *) malloc(sizeof(int) * n);
+	if (a == NULL || j == NULL || x == NULL) {
+		printf("記憶體配置失敗！\n");
+		return 1;
+	}
+
+	for (s = 0; s < NUM_SETS; s++) {
+		if (s == 0)
+			fill_random(a, n);
+		else if (s == 1)
+			fill_sequential(a, n);
+		else
+			fill_edge(a, n);
+
+		for (i = 0; i < n; i++) {
+			j[i] = DateToSerial(a[i]);
+			// 連續輸入就一天一天加；其他的加減十萬天以內
+			x[i] = s == 1 ? 1 : (int) (rng_next() % 200001) - 100000;
+		}
+
+		// 先熱身一輪，讓資料進快取、分支預測穩定下來
+		for (op = 0; op < NUM_OPS; op++)
+			bench_op(op, a, j, x, n, &sink);
+		for (op = 0; op < NUM_OPS; op++)
+			ns[s][op] = bench_op(op, a, j, x, n, &sink);
+	}
+
+	printf("=================================================\n");
+	printf("date 函式庫效能 (n = %d，單位 ns/op)\n", n);
+	printf("=================================================\n");
+	printf("%-14s", "操作");
+	for (s = 0; s < NUM_SETS; s++)
+		printf(" %12s", SET_NAMES[s]);
+	printf("\n-------------------------------------------------\n");
+	for (op = 0; op < NUM_OPS; op++) {
+		printf("%-14s", OP_NAMES[op]);
+		for (s = 0; s < NUM_SETS; s++)
+			printf(" %12.2f", ns[s][op]);
+		putchar('\n');
+	}
+	printf("=================================================\n");
+	printf("(checksum %llu)\n", (unsigned long long) sink);
+
+	free(x);
+	free(j);
+	free(a);
+	return 0;
+}
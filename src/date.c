@@ -0,0 +1,122 @@
+// date 資料型態與其相關操作（函式庫版）
+// 作者：蔡秀吉 (H. C. Tsai)
+// 電子信箱：hctsai@linux
+
+#include "date.h"
+
+// 月份與星期名：輸出用
+static const char *MONTHS[12] = {
+	"January", "February", "March", "April", "May", "June",
+	"July", "August", "September", "October", "November", "December"
+};
+
+static const char *WEEK_SUN_TO_SAT[7] = {
+	"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+
+// ============================================================
+// Gregorian ⇄ JDN（Fliegel–Van Flandern）
+// ============================================================
+
+static int64_t to_jdn(const int y0, const int m0, const int d0)
+{
+	int a, y, m;
+
+	a = (14 - m0) / 12;
+	y = y0 + 4800 - a;
+	m = m0 + 12 * a - 3;
+	return d0 + (153 * m + 2) / 5 + 365LL * y + y / 4 - y / 100 + y / 400 - 32045;
+}
+
+static void from_jdn(const int64_t j, int *y, int *m, int *d)
+{
+	int64_t a, b, c, d1, e, m1;
+
+	// 把 JDN 還原為 (y,m,d)。配對是對稱的，不能改順序。
+	a = j + 32044;
+	b = (4 * a + 3) / 146097;
+	c = a - (146097 * b) / 4;
+	d1 = (4 * c + 3) / 1461;
+	e = c - (1461 * d1) / 4;
+	m1 = (5 * e + 2) / 153;
+	*d = (int) (e - (153 * m1 + 2) / 5 + 1);
+	*m = (int) (m1 + 3 - 12 * (m1 / 10));
+	*y = (int) (100 * b + d1 - 4800 + (m1 / 10));
+}
+
+// ============================================================
+// 日期操作
+// ============================================================
+
+int is_leap(const int y)
+{
+	if (y % 400 == 0)
+		return 1;
+	if (y % 100 == 0)
+		return 0;
+	return y % 4 == 0;
+}
+
+int valid_date(const date dt)
+{
+	static const int md[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	int lim;
+
+	if (dt.m < 1 || dt.m > 12)
+		return 0;
+	lim = md[dt.m - 1];
+	if (dt.m == 2 && is_leap(dt.y))
+		lim = 29;
+	return dt.d >= 1 && dt.d <= lim;
+}
+
+int64_t DateToSerial(const date dt)
+{
+	return to_jdn(dt.y, dt.m, dt.d);
+}
+
+date SerialToDate(const int64_t j)
+{
+	date out;
+
+	from_jdn(j, &out.y, &out.m, &out.d);
+	return out;
+}
+
+date DateAdd(const date d, const int n)
+{
+	return SerialToDate(DateToSerial(d) + (int64_t) n);
+}
+
+int DateSub(const date d1, const date d2)
+{
+	int64_t diff;
+
+	diff = DateToSerial(d2) - DateToSerial(d1);
+	if (diff < -(int64_t) 0x7fffffff)
+		diff = -(int64_t) 0x7fffffff;
+	if (diff > (int64_t) 0x7fffffff)
+		diff = (int64_t) 0x7fffffff;
+	return (int) diff;
+}
+
+int DayOfWeekIndex(const date dt)
+{
+	int64_t j;
+	int idx;
+
+	// JDN 的模 7：Monday = 0 .. Sunday = 6，加一讓 Sunday 變成 0
+	j = DateToSerial(dt);
+	idx = (int) ((j % 7 + 7) % 7);
+	return (idx + 1) % 7;
+}
+
+const char *DayOfWeek(const date dt)
+{
+	return WEEK_SUN_TO_SAT[DayOfWeekIndex(dt)];
+}
+
+const char *MonthName(const int m)
+{
+	return MONTHS[m - 1];
+}
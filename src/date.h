@@ -0,0 +1,48 @@
+// date 資料型態與其相關操作（函式庫版）
+// 內容取自 Assignment_I/p1.cpp 的純量實作，改寫成 C99 讓其他程式可以直接連結
+// 作者：蔡秀吉 (H. C. Tsai)
+// 電子信箱：hctsai@linux
+
+#ifndef DATE_H
+#define DATE_H
+
+#include <stdint.h>
+
+// ============================================================
+// 資料結構定義
+// ============================================================
+
+typedef struct {
+	int y;	// 年（Year）
+	int m;	// 月（1..12）
+	int d;	// 日（1..28/29/30/31）
+} date;
+
+// ============================================================
+// 日期操作
+// ============================================================
+
+// 閏年判斷：400/100/4 規則
+int is_leap(const int y);
+
+// 合法回傳 1，否則回傳 0（月份 1..12、日數不超過當月天數）
+int valid_date(const date dt);
+
+// 公曆日期 ⇄ 連號（Julian Day Number）；SerialToDate 適用於 JDN >= -32044（約西元前 4800 年）
+int64_t DateToSerial(const date dt);
+date SerialToDate(const int64_t j);
+
+// d 之後 n 天（n 可為負）
+date DateAdd(const date d, const int n);
+
+// 從 d1 到 d2 的有號天數（d2 - d1），超出 int 範圍時夾在 ±0x7fffffff
+int DateSub(const date d1, const date d2);
+
+// 星期幾：DayOfWeekIndex 回傳 0..6（Sunday = 0），DayOfWeek 回傳英文名稱
+int DayOfWeekIndex(const date dt);
+const char *DayOfWeek(const date dt);
+
+// 月份英文名稱；m 必須在 1..12
+const char *MonthName(const int m);
+
+#endif
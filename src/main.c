@@ -0,0 +1,46 @@
+// date 函式庫示範：讀 stdin 的查詢，輸出格式與 Assignment_I/p1.cpp 相同
+// 作者：蔡秀吉 (H. C. Tsai)
+// 電子信箱：hctsai@linux
+
+#include <stdio.h>
+#include "date.h"
+
+// 輸出：MonthName dd, yyyy
+static void print_month_date_year(const date dt)
+{
+	printf("%s %d, %d", MonthName(dt.m), dt.d, dt.y);
+}
+
+int main(void)
+{
+	char buf[256];
+	date d1, d2;
+	int k;
+
+	// 解析順序跟 p1 一樣：區間 → 加法 → 單日
+	while (fgets(buf, sizeof(buf), stdin)) {
+		if (sscanf(buf, " %d/%d/%d - %d/%d/%d ", &d1.y, &d1.m, &d1.d, &d2.y, &d2.m, &d2.d) == 6) {
+			if (!valid_date(d1) || !valid_date(d2))
+				continue;
+			printf("%d days from ", DateSub(d1, d2));
+			print_month_date_year(d1);
+			printf(" to ");
+			print_month_date_year(d2);
+			printf(".\n");
+		} else if (sscanf(buf, " %d/%d/%d + %d ", &d1.y, &d1.m, &d1.d, &k) == 4) {
+			if (!valid_date(d1))
+				continue;
+			printf("%d days after ", k);
+			print_month_date_year(d1);
+			printf(" is ");
+			print_month_date_year(DateAdd(d1, k));
+			printf(".\n");
+		} else if (sscanf(buf, " %d/%d/%d ", &d1.y, &d1.m, &d1.d) == 3) {
+			if (!valid_date(d1))
+				continue;
+			print_month_date_year(d1);
+			printf(" is %s.\n", DayOfWeek(d1));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,211 @@
+// date 函式庫測試：跟逐日往前數的暴力計數器交叉比對
+// 作者：蔡秀吉 (H. C. Tsai)
+// 電子信箱：hctsai@linux
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "date.h"
+
+// ============================================================
+// 簡易測試框架
+// ============================================================
+
+static long checks, failures;
+
+#define CHECK(cond, ...) \
+	do { \
+		checks++; \
+		if (!(cond)) { \
+			failures++; \
+			if (failures <= 20) { \
+				printf("  失敗 %s:%d: ", __FILE__, __LINE__); \
+				printf(__VA_ARGS__); \
+				putchar('\n'); \
+			} \
+		} \
+	} while (0)
+
+// ============================================================
+// 暴力計數器：不靠任何公式，只知道每個月有幾天
+// ============================================================
+
+static int month_days(const int y, const int m)
+{
+	switch (m) {
+	case 2:
+		if (y % 400 == 0)
+			return 29;
+		if (y % 100 == 0)
+			return 28;
+		return y % 4 == 0 ? 29 : 28;
+	case 4: case 6: case 9: case 11:
+		return 30;
+	default:
+		return 31;
+	}
+}
+
+static void next_day(date *dt)
+{
+	if (dt->d < month_days(dt->y, dt->m)) {
+		dt->d++;
+		return;
+	}
+	dt->d = 1;
+	if (dt->m < 12) {
+		dt->m++;
+		return;
+	}
+	dt->m = 1;
+	dt->y++;
+}
+
+static int same_date(const date a, const date b)
+{
+	return a.y == b.y && a.m == b.m && a.d == b.d;
+}
+
+// xorshift64：固定種子，失敗時可以重現
+static unsigned long long rng = 88172645463325252ULL;
+
+static unsigned long long rng_next(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng;
+}
+
+// ============================================================
+// 測試項目
+// ============================================================
+
+// 從西元前 4000 年一路數到 9999 年底：連號、反轉換、合法性、星期幾每天都要對
+static void test_walk(void)
+{
+	const date first = {-4000, 1, 1};
+	const date last = {9999, 12, 31};
+	const date anchor = {2000, 1, 1};	// 2000/1/1 是星期六
+	date cur;
+	long k, k_anchor;
+	int64_t j0;
+
+	printf("逐日比對 %d/%d/%d .. %d/%d/%d\n", first.y, first.m, first.d, last.y, last.m, last.d);
+
+	k_anchor = 0;
+	for (cur = first; !same_date(cur, anchor); next_day(&cur))
+		k_anchor++;
+
+	j0 = DateToSerial(first);
+	k = 0;
+	for (cur = first; ; next_day(&cur), k++) {
+		int64_t j = j0 + k;
+		date back = SerialToDate(j);
+		int wd = (int) (((6 + k - k_anchor) % 7 + 7) % 7);
+
+		CHECK(DateToSerial(cur) == j, "DateToSerial(%d/%d/%d) = %lld，應為 %lld",
+		      cur.y, cur.m, cur.d, (long long) DateToSerial(cur), (long long) j);
+		CHECK(same_date(back, cur), "SerialToDate(%lld) = %d/%d/%d，應為 %d/%d/%d",
+		      (long long) j, back.y, back.m, back.d, cur.y, cur.m, cur.d);
+		CHECK(valid_date(cur), "%d/%d/%d 應該合法", cur.y, cur.m, cur.d);
+		CHECK(DayOfWeekIndex(cur) == wd, "DayOfWeekIndex(%d/%d/%d) = %d，應為 %d",
+		      cur.y, cur.m, cur.d, DayOfWeekIndex(cur), wd);
+
+		// 月底：再多一天、第 0 天都不合法
+		if (cur.d == month_days(cur.y, cur.m)) {
+			date over = {cur.y, cur.m, cur.d + 1};
+			date zero = {cur.y, cur.m, 0};
+			CHECK(!valid_date(over), "%d/%d/%d 應該不合法", over.y, over.m, over.d);
+			CHECK(!valid_date(zero), "%d/%d/%d 應該不合法", zero.y, zero.m, zero.d);
+		}
+
+		if (same_date(cur, last))
+			break;
+	}
+}
+
+// 1600..2400 年的日期依序放進陣列，索引差就是天數差，拿來驗 DateAdd / DateSub
+static void test_add_sub(void)
+{
+	const date first = {1600, 1, 1};
+	const date last = {2400, 12, 31};
+	date *days, cur;
+	long n, i, a, b;
+
+	n = 0;
+	for (cur = first; ; next_day(&cur)) {
+		n++;
+		if (same_date(cur, last))
+			break;
+	}
+	days = (date *) malloc(sizeof(date) * n);
+	if (days == NULL) {
+		CHECK(0, "記憶體配置失敗");
+		return;
+	}
+	i = 0;
+	for (cur = first; i < n; next_day(&cur))
+		days[i++] = cur;
+
+	printf("DateAdd / DateSub 隨機比對（%ld 天）\n", n);
+	for (i = 0; i < 1000000; i++) {
+		date r;
+
+		a = (long) (rng_next() % (unsigned long long) n);
+		b = (long) (rng_next() % (unsigned long long) n);
+		r = DateAdd(days[a], (int) (b - a));
+		CHECK(DateSub(days[a], days[b]) == (int) (b - a), "DateSub(%d/%d/%d, %d/%d/%d) = %d，應為 %ld",
+		      days[a].y, days[a].m, days[a].d, days[b].y, days[b].m, days[b].d,
+		      DateSub(days[a], days[b]), b - a);
+		CHECK(same_date(r, days[b]), "DateAdd(%d/%d/%d, %ld) = %d/%d/%d，應為 %d/%d/%d",
+		      days[a].y, days[a].m, days[a].d, b - a, r.y, r.m, r.d, days[b].y, days[b].m, days[b].d);
+	}
+	free(days);
+}
+
+// 講義範例與邊界值
+static void test_fixed(void)
+{
+	const date d0909 = {2025, 9, 9};
+	const date leap = {2024, 2, 29};
+	const date mar1 = {2025, 3, 1};
+	const date y1900 = {1900, 2, 29};
+	const date y2000 = {2000, 2, 29};
+	const date bad_m0 = {2025, 0, 1};
+	const date bad_m13 = {2025, 13, 1};
+	const date far_past = {-2000000000, 1, 1};
+	const date far_future = {2000000000, 1, 1};
+	const date jan1 = {2025, 1, 1};
+	date r;
+
+	printf("固定案例\n");
+	CHECK(DayOfWeekIndex(d0909) == 2, "2025/9/9 應為星期二");
+	r = DateAdd(jan1, 65);
+	CHECK(r.y == 2025 && r.m == 3 && r.d == 7, "2025/1/1 + 65 應為 2025/3/7");
+	CHECK(DateSub(leap, mar1) == 366, "2024/2/29 到 2025/3/1 應為 366 天");
+	CHECK(DateSub(mar1, leap) == -366, "2025/3/1 到 2024/2/29 應為 -366 天");
+	CHECK(!valid_date(y1900), "1900/2/29 不合法");
+	CHECK(valid_date(y2000), "2000/2/29 合法");
+	CHECK(!valid_date(bad_m0) && !valid_date(bad_m13), "月份 0 與 13 不合法");
+	CHECK(DateSub(far_past, far_future) == 0x7fffffff, "超出 int 的差值要夾在 0x7fffffff");
+	CHECK(DateSub(far_future, far_past) == -0x7fffffff, "超出 int 的差值要夾在 -0x7fffffff");
+}
+
+// ============================================================
+// 主程式
+// ============================================================
+
+int main(void)
+{
+	printf("=================================================\n");
+	printf("date 函式庫測試\n");
+	printf("=================================================\n");
+
+	test_fixed();
+	test_walk();
+	test_add_sub();
+
+	printf("=================================================\n");
+	printf("%ld 項檢查，%ld 項失敗\n", checks, failures);
+	return failures != 0;
+}